@@ -1,382 +1,4073 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#endif
+
+#ifdef __linux__
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+
+#define MAX_NOME 64
+#define MAX_PISTA 128
+#define HASH_CAPACIDADE_INICIAL 16 /* potencia de dois */
+#define ARENA_BLOCO (64 * 1024)   /* tamanho padrao de cada bloco de arena */
+#define ID_VAZIO 0                /* id da string vazia no pool (sala sem pista, pista sem suspeito) */
+#define NO_NULO 0                 /* indice do no sentinela da arvore de pistas */
+#define AVL_ALTURA_MAX 64         /* altura de uma AVL com ate 2^32 nos fica abaixo de 47 */
+#define SEM_FILHO 0               /* na mansao compacta: a raiz (0) nunca e filha de ninguem */
+
+/* ===========================
+   ESTRUTURAS
+   =========================== */
+
+/* Bloco de uma arena: cabecalho seguido dos dados */
+typedef struct ArenaBloco {
+    struct ArenaBloco *prox;
+    size_t usado;
+    size_t capacidade;
+    _Alignas(max_align_t) unsigned char dados[];
+} ArenaBloco;
+
+/*
+ * Arena: alocador sequencial por blocos. Os objetos de um mesmo tipo ficam
+ * contiguos e nao sao liberados um a um; a arena inteira e resetada de uma vez.
+ * Guarda contadores para o relatorio de memoria.
+ */
+typedef struct {
+    const char *nome;
+    ArenaBloco *blocos;   /* bloco atual primeiro */
+    size_t objetos;       /* objetos alocados desde o ultimo reset */
+    size_t bytes;         /* bytes entregues aos objetos */
+    size_t reservado;     /* bytes em blocos obtidos do sistema */
+    size_t numBlocos;
+} Arena;
+
+/* Nó da árvore da mansão (cada sala); nome e pista sao ids do pool de strings */
+typedef struct Sala {
+    uint32_t nome;
+    uint32_t pista; /* pista associada a essa sala (ID_VAZIO se nao houver) */
+    struct Sala *esq;
+    struct Sala *dir;
+} Sala;
+
+/* Mansao carregada: todas as salas num unico vetor (indice 0 = raiz) */
+typedef struct {
+    Sala *salas;
+    size_t quantidade;
+} Mansao;
+
+/*
+ * Mansao compacta: as salas em ordem de largura (BFS) em vetores paralelos,
+ * com indices de filhos no lugar de ponteiros e os textos fora da linha (pool).
+ * Montada a partir da Mansao para percursos nao interativos.
+ */
+typedef struct {
+    uint32_t *esq;        /* indice do filho ou SEM_FILHO */
+    uint32_t *dir;
+    uint32_t *nome;       /* ids do pool */
+    uint32_t *pista;
+    uint32_t quantidade;
+} MansaoCompacta;
+
+/* resultado de um roteiro como "eedd" */
+typedef struct {
+    uint32_t sala;        /* indice (na mansao compacta) onde o roteiro terminou */
+    uint32_t passos;      /* movimentos feitos */
+    uint32_t ignorados;   /* passos bloqueados ou comandos invalidos */
+} ResultadoCaminho;
+
+/* Nó da arvore AVL de pistas coletadas (id da pista; ordenação pelo texto).
+   Filhos sao indices no vetor de nos da arvore (NO_NULO = sem filho). */
+typedef struct {
+    uint32_t pista;
+    uint32_t esq;
+    uint32_t dir;
+    int32_t altura;
+} PistaNode;
+
+/*
+ * Arvore AVL de pistas: todos os nos num vetor que cresce dobrando; o indice 0
+ * e um sentinela de altura 0 que faz o papel de NULL. A altura fica em
+ * O(log n) mesmo com pistas chegando em ordem, e os percursos usam pilha propria.
+ */
+typedef struct {
+    PistaNode *nos;
+    uint32_t quantidade;  /* inclui o sentinela */
+    uint32_t capacidade;
+    uint32_t raiz;
+    void *mapa;           /* snapshot mapeado que contem 'nos' (NULL: nos no heap) */
+    size_t tamMapa;
+} ArvorePistas;
+
+
+/*
+ * Posicao da tabela hash: hash completo da chave (0 = posicao livre), chave e valor.
+ * Na tabela pista -> suspeito a chave e o id da pista e o valor o id do suspeito.
+ */
+typedef struct {
+    uint32_t hash;
+    uint32_t chave;
+    uint32_t valor;
+} HashSlot;
+
+/*
+ * Tabela hash com enderecamento aberto (Robin Hood): vetor de HashSlot com
+ * capacidade potencia de dois, que dobra quando a carga passa de 7/8.
+ * Cada posicao guarda o hash completo, entao a maioria das comparacoes entre
+ * chaves diferentes e resolvida sem olhar a chave.
+ */
+typedef struct BasePistas BasePistas;
+
+typedef struct {
+    HashSlot *slots;
+    size_t capacidade;
+    size_t quantidade;
+    BasePistas *disco;    /* mapa pista -> suspeito em disco (NULL: so os slots) */
+} HashTable;
+
+/*
+ * Identidade do conteudo de um pool. Arquivos que guardam ids do pool
+ * (sessoes, base de pistas) so valem para um pool com a mesma assinatura.
+ */
+typedef struct {
+    uint64_t tamTexto;
+    uint32_t numIds;
+    uint32_t hashTexto;
+} AssinaturaPool;
+
+/*
+ * Pool de strings: cada texto distinto (nomes de sala, pistas, suspeitos) e
+ * guardado uma unica vez num buffer continuo e identificado por um id uint32.
+ * Comparar textos vira comparar ids.
+ */
+typedef struct {
+    char *texto;          /* strings terminadas em '\0', uma apos a outra */
+    size_t tamTexto;
+    size_t capTexto;
+    uint32_t *inicio;     /* id -> deslocamento em 'texto' */
+    uint32_t quantidade;
+    uint32_t capIds;
+    HashTable indice;     /* djb2 do texto -> id (na chave) */
+    AssinaturaPool assinatura; /* calculada uma vez, ao fim da carga da mansao */
+} InternPool;
+
+/*
+ * Indice de busca por palavra/prefixo: vocabulario (palavras em minusculas)
+ * em ordem alfabetica, cada palavra com a lista ordenada de pistas que a
+ * contem, e as salas de cada pista.
+ */
+typedef struct {
+    InternPool palavras;      /* vocabulario */
+    uint32_t *vocab;          /* ids de palavras em ordem alfabetica */
+    uint32_t *vocabInicio;    /* posicao no vocab -> inicio em 'ocorrencias' (numVocab + 1) */
+    uint32_t *ocorrencias;    /* ids de pistas agrupados por palavra */
+    uint32_t *salasInicio;    /* id da pista -> inicio em 'salas' (ids do pool + 1) */
+    uint32_t *salas;          /* indices de salas agrupados por pista */
+    uint32_t numVocab;
+    size_t numOcorrencias;
+    size_t numPistas;
+} IndiceBusca;
+
+/*
+ * Investigacao de um jogador: pistas coletadas e, por suspeito, quantas delas
+ * apontam para ele. A contagem e atualizada no momento em que uma pista nova
+ * entra na arvore, entao cada acusacao e uma unica consulta.
+ */
+typedef struct {
+    ArvorePistas pistas;
+    HashTable contagem;   /* id do suspeito -> pistas coletadas que apontam para ele */
+} Investigacao;
+
+/* ===========================
+   ARENAS
+   =========================== */
+
+/* alinhamento usado para todos os objetos da arena */
+#define ARENA_ALINHAMENTO _Alignof(max_align_t)
+
+void arenaIniciar(Arena *a, const char *nome) {
+    a->nome = nome;
+    a->blocos = NULL;
+    a->objetos = 0;
+    a->bytes = 0;
+    a->reservado = 0;
+    a->numBlocos = 0;
+}
+
+/* obtem do sistema um bloco com pelo menos 'minimo' bytes */
+static ArenaBloco* arenaNovoBloco(Arena *a, size_t minimo) {
+    size_t cap = minimo > ARENA_BLOCO ? minimo : ARENA_BLOCO;
+    ArenaBloco *b = (ArenaBloco*) malloc(sizeof(ArenaBloco) + cap);
+    if (!b) {
+        fprintf(stderr, "Erro: falha ao alocar bloco da arena %s\n", a->nome);
+        exit(1);
+    }
+    b->usado = 0;
+    b->capacidade = cap;
+    b->prox = a->blocos;
+    a->blocos = b;
+    a->reservado += cap;
+    a->numBlocos++;
+    return b;
+}
+
+/*
+ * arenaAlocarVetor() – reserva 'n' objetos de 'tamanho' bytes contiguos (memoria zerada).
+ * Pedidos maiores que um bloco ganham um bloco proprio.
+ */
+void* arenaAlocarVetor(Arena *a, size_t tamanho, size_t n) {
+    if (n != 0 && tamanho > SIZE_MAX / n) {
+        fprintf(stderr, "Erro: pedido grande demais para a arena %s\n", a->nome);
+        exit(1);
+    }
+    size_t total = (tamanho * n + ARENA_ALINHAMENTO - 1) & ~(ARENA_ALINHAMENTO - 1);
+    ArenaBloco *b = a->blocos;
+    if (!b || b->capacidade - b->usado < total) b = arenaNovoBloco(a, total);
+    void *p = b->dados + b->usado;
+    b->usado += total;
+    a->objetos += n;
+    a->bytes += tamanho * n;
+    memset(p, 0, total);
+    return p;
+}
+
+void* arenaAlocar(Arena *a, size_t tamanho) {
+    return arenaAlocarVetor(a, tamanho, 1);
+}
+
+/* arenaResetar() – descarta todos os objetos; mantem so o primeiro bloco para reuso */
+void arenaResetar(Arena *a) {
+    ArenaBloco *b = a->blocos;
+    while (b && b->prox) {
+        ArenaBloco *prox = b->prox;
+        a->reservado -= b->capacidade;
+        a->numBlocos--;
+        free(b);
+        b = prox;
+    }
+    a->blocos = b;
+    if (b) b->usado = 0;
+    a->objetos = 0;
+    a->bytes = 0;
+}
+
+/* devolve todos os blocos ao sistema */
+void arenaLiberar(Arena *a) {
+    arenaResetar(a);
+    free(a->blocos);
+    arenaIniciar(a, a->nome);
+}
+
+/* uma linha do relatorio de memoria por estrutura */
+void relatarLinha(const char *nome, size_t objetos, size_t bytes, size_t reservado, size_t blocos) {
+    fprintf(stderr, "%-10s %12zu %14zu %8zu %14zu %7zu\n",
+            nome, objetos, bytes, objetos ? bytes / objetos : 0, reservado, blocos);
+}
+
+/* cabecalho do relatorio e uma linha por arena */
+void relatarArenas(Arena *const *arenas, int n) {
+    fprintf(stderr, "%-10s %12s %14s %8s %14s %7s\n",
+            "estrutura", "objetos", "bytes", "B/obj", "reservado", "blocos");
+    for (int i = 0; i < n; i++) {
+        const Arena *a = arenas[i];
+        relatarLinha(a->nome, a->objetos, a->bytes, a->reservado, a->numBlocos);
+    }
+}
+
+/* ===========================
+   FUNCOES DA HASH (Robin Hood)
+   =========================== */
+
+/* mistura de um id (bijetiva, entao hash igual implica id igual; id 0 nunca e chave) */
+static uint32_t hashId(uint32_t id) {
+    id ^= id >> 16;
+    id *= 0x85EBCA6Bu;
+    id ^= id >> 13;
+    id *= 0xC2B2AE35u;
+    id ^= id >> 16;
+    return id;
+}
+
+/*
+ * hash simples para trechos de string: djb2, seguido da mistura de hashId() para
+ * espalhar os bits baixos (que escolhem a posicao): textos parecidos, como
+ * numeros seguidos, dariam djb2 vizinhos e longas sequencias de sondagem.
+ * Como a mistura e bijetiva, colisoes de djb2 continuam sendo colisoes.
+ * 0 e reservado para posicao livre.
+ */
+static uint32_t hashTrecho(const char *str, size_t len) {
+    uint32_t hash = 5381;
+    for (size_t i = 0; i < len; i++)
+        hash = ((hash << 5) + hash) + (unsigned char) str[i]; /* hash * 33 + c */
+    hash = hashId(hash);
+    return hash ? hash : 1;
+}
+
+/* distancia da posicao 'pos' ate a posicao ideal do hash 'h' */
+static size_t distanciaSondagem(const HashTable *ht, uint32_t h, size_t pos) {
+    return (pos - (h & (ht->capacidade - 1))) & (ht->capacidade - 1);
+}
+
+/* aloca um vetor de posicoes livres */
+static HashSlot* alocarSlots(size_t capacidade) {
+    HashSlot *slots = (HashSlot*) calloc(capacidade, sizeof(HashSlot));
+    if (!slots) {
+        fprintf(stderr, "Erro: falha ao alocar tabela hash\n");
+        exit(1);
+    }
+    return slots;
+}
+
+/* coloca uma entrada (que sabidamente nao esta na tabela) pelo metodo Robin Hood:
+   quem esta mais longe da posicao ideal fica com a posicao */
+static void posicionarEntrada(HashTable *ht, HashSlot entrada) {
+    size_t mascara = ht->capacidade - 1;
+    size_t pos = entrada.hash & mascara;
+    size_t dist = 0;
+    for (;;) {
+        HashSlot *slot = &ht->slots[pos];
+        if (slot->hash == 0) {
+            *slot = entrada;
+            return;
+        }
+        size_t distResidente = distanciaSondagem(ht, slot->hash, pos);
+        if (distResidente < dist) {
+            HashSlot t = *slot;
+            *slot = entrada;
+            entrada = t;
+            dist = distResidente;
+        }
+        pos = (pos + 1) & mascara;
+        dist++;
+    }
+}
+
+/* troca o vetor de posicoes por um de capacidade 'novaCap' e reposiciona as entradas */
+static void redimensionarHash(HashTable *ht, size_t novaCap) {
+    HashSlot *antigos = ht->slots;
+    size_t capAntiga = ht->capacidade;
+    ht->capacidade = novaCap;
+    ht->slots = alocarSlots(ht->capacidade);
+    for (size_t i = 0; i < capAntiga; i++) {
+        if (antigos[i].hash)
+            posicionarEntrada(ht, antigos[i]);
+    }
+    free(antigos);
+}
+
+/* compara a chave de uma posicao com a chave procurada (NULL: hash igual basta) */
+typedef int (*HashIgual)(const void *ctx, uint32_t chave, const void *procurada);
+
+/* procura a posicao com hash 'h' cuja chave e igual a 'procurada'; NULL se nao existir */
+static HashSlot* buscarSlot(const HashTable *ht, uint32_t h, HashIgual igual,
+                            const void *ctx, const void *procurada) {
+    size_t mascara = ht->capacidade - 1;
+    size_t pos = h & mascara;
+    for (size_t dist = 0;; dist++) {
+        HashSlot *slot = &ht->slots[pos];
+        /* posicao livre ou residente mais perto de casa do que nos: a chave nao existe */
+        if (slot->hash == 0 || distanciaSondagem(ht, slot->hash, pos) < dist)
+            return NULL;
+        if (slot->hash == h && (!igual || igual(ctx, slot->chave, procurada)))
+            return slot;
+        pos = (pos + 1) & mascara;
+    }
+}
+
+/* insere uma entrada nova, crescendo a tabela se a carga passar de 7/8 */
+static void adicionarSlot(HashTable *ht, uint32_t h, uint32_t chave, uint32_t valor) {
+    if ((ht->quantidade + 1) * 8 > ht->capacidade * 7)
+        redimensionarHash(ht, ht->capacidade * 2);
+    HashSlot novo = { h, chave, valor };
+    posicionarEntrada(ht, novo);
+    ht->quantidade++;
+}
+
+/*
+ * inserirNaHash() – insere associacao pista -> suspeito (ids do pool) na tabela hash.
+ * Se ja existir a pista, sobrescreve o suspeito (nao deveria ocorrer no uso normal).
+ */
+void inserirNaHash(HashTable *ht, uint32_t pista, uint32_t suspeito) {
+    if (pista == ID_VAZIO) return;
+    uint32_t h = hashId(pista);
+    HashSlot *slot = buscarSlot(ht, h, NULL, NULL, NULL);
+    if (slot) {
+        slot->valor = suspeito; /* sobrescrever suspeito */
+        return;
+    }
+    adicionarSlot(ht, h, pista, suspeito);
+}
+
+uint32_t consultarBasePistas(BasePistas *b, uint32_t pista); /* base em disco */
+
+/*
+ * encontrarSuspeito() – consulta a tabela hash usando o id da pista como chave.
+ * Com uma base em disco ligada, a consulta vai para ela (Bloom, cache, disco).
+ * Retorna o id do suspeito ou ID_VAZIO se nao achar.
+ */
+uint32_t encontrarSuspeito(const HashTable *ht, uint32_t pista) {
+    if (pista == ID_VAZIO) return ID_VAZIO;
+    if (ht->disco) return consultarBasePistas(ht->disco, pista);
+    HashSlot *slot = buscarSlot(ht, hashId(pista), NULL, NULL, NULL);
+    return slot ? slot->valor : ID_VAZIO;
+}
+
+/* somarNaHash() – soma 'delta' ao valor da chave (id), criando-a com 0 se nao existir.
+   Retorna o novo valor. */
+uint32_t somarNaHash(HashTable *ht, uint32_t chave, uint32_t delta) {
+    uint32_t h = hashId(chave);
+    HashSlot *slot = buscarSlot(ht, h, NULL, NULL, NULL);
+    if (slot) return slot->valor += delta;
+    adicionarSlot(ht, h, chave, delta);
+    return delta;
+}
+
+/* remove todas as entradas mantendo a capacidade */
+void limparHash(HashTable *ht) {
+    memset(ht->slots, 0, ht->capacidade * sizeof(HashSlot));
+    ht->quantidade = 0;
+}
+
+/* libera o vetor de posicoes */
+void liberarHash(HashTable *ht) {
+    free(ht->slots);
+    ht->slots = NULL;
+    ht->capacidade = 0;
+    ht->quantidade = 0;
+}
+
+/* copia o conteudo de 'orig' para 'dest' (nova tabela com a mesma capacidade) */
+void copiarHash(HashTable *dest, const HashTable *orig) {
+    dest->capacidade = orig->capacidade;
+    dest->quantidade = orig->quantidade;
+    dest->slots = alocarSlots(orig->capacidade);
+    memcpy(dest->slots, orig->slots, orig->capacidade * sizeof(HashSlot));
+    dest->disco = orig->disco;
+}
+
+/* garante capacidade para 'n' entradas sem crescer durante a carga */
+void reservarHash(HashTable *ht, size_t n) {
+    size_t cap = ht->capacidade;
+    while (n * 8 > cap * 7) cap *= 2;
+    if (cap != ht->capacidade) redimensionarHash(ht, cap);
+}
+
+/* inicializa a hash (tabela vazia com a capacidade inicial) */
+void initHash(HashTable *ht) {
+    ht->capacidade = HASH_CAPACIDADE_INICIAL;
+    ht->quantidade = 0;
+    ht->slots = alocarSlots(ht->capacidade);
+    ht->disco = NULL;
+}
+
+/* ===========================
+   POOL DE STRINGS (internamento)
+   =========================== */
+
+/* trecho de string ainda nao internado (usado como chave de busca no indice) */
+typedef struct {
+    const char *s;
+    size_t len;
+} Trecho;
+
+static int igualTexto(const void *ctx, uint32_t id, const void *procurada) {
+    const InternPool *pool = (const InternPool*) ctx;
+    const Trecho *t = (const Trecho*) procurada;
+    const char *texto = pool->texto + pool->inicio[id];
+    return memcmp(texto, t->s, t->len) == 0 && texto[t->len] == '\0';
+}
+
+/* garante espaco para mais 'ids' strings somando 'bytes' de texto
+   (cresce pelo menos o dobro, para inserir uma a uma em tempo amortizado constante) */
+void internReservar(InternPool *pool, size_t ids, size_t bytes) {
+    if (pool->tamTexto + bytes > pool->capTexto) {
+        size_t cap = pool->capTexto * 2;
+        if (cap < pool->tamTexto + bytes) cap = pool->tamTexto + bytes;
+        if (cap > UINT32_MAX) {
+            fprintf(stderr, "Erro: pool de strings excede 4 GB\n");
+            exit(1);
+        }
+        char *novo = (char*) realloc(pool->texto, cap);
+        if (!novo) {
+            fprintf(stderr, "Erro: falha ao alocar pool de strings\n");
+            exit(1);
+        }
+        pool->texto = novo;
+        pool->capTexto = cap;
+    }
+    if (pool->quantidade + ids > pool->capIds) {
+        size_t cap = (size_t) pool->capIds * 2;
+        if (cap < pool->quantidade + ids) cap = pool->quantidade + ids;
+        uint32_t *novo = (uint32_t*) realloc(pool->inicio, cap * sizeof(uint32_t));
+        if (!novo) {
+            fprintf(stderr, "Erro: falha ao alocar pool de strings\n");
+            exit(1);
+        }
+        pool->inicio = novo;
+        pool->capIds = (uint32_t) cap;
+    }
+    reservarHash(&pool->indice, pool->quantidade + ids);
+}
+
+/* inicializa o pool com a string vazia como id 0 (ID_VAZIO) */
+void internIniciar(InternPool *pool) {
+    pool->capTexto = 256;
+    pool->capIds = 16;
+    pool->texto = (char*) malloc(pool->capTexto);
+    pool->inicio = (uint32_t*) malloc(pool->capIds * sizeof(uint32_t));
+    if (!pool->texto || !pool->inicio) {
+        fprintf(stderr, "Erro: falha ao alocar pool de strings\n");
+        exit(1);
+    }
+    initHash(&pool->indice);
+    pool->texto[0] = '\0';
+    pool->tamTexto = 1;
+    pool->inicio[0] = 0;
+    pool->quantidade = 1;
+    memset(&pool->assinatura, 0, sizeof(pool->assinatura));
+}
+
+/*
+ * internar() – devolve o id do trecho 's' (tamanho 'len'), guardando-o no pool
+ * na primeira vez. Strings iguais sempre recebem o mesmo id.
+ */
+uint32_t internar(InternPool *pool, const char *s, size_t len) {
+    if (len == 0) return ID_VAZIO;
+    Trecho t = { s, len };
+    uint32_t h = hashTrecho(s, len);
+    HashSlot *slot = buscarSlot(&pool->indice, h, igualTexto, pool, &t);
+    if (slot) return slot->chave;
+    internReservar(pool, 1, len + 1);
+    uint32_t id = pool->quantidade++;
+    pool->inicio[id] = (uint32_t) pool->tamTexto;
+    memcpy(pool->texto + pool->tamTexto, s, len);
+    pool->texto[pool->tamTexto + len] = '\0';
+    pool->tamTexto += len + 1;
+    adicionarSlot(&pool->indice, h, id, 0);
+    return id;
+}
+
+/* internBuscarTrecho() – id de um trecho ja internado, ou ID_VAZIO se ele nao existir.
+   So le o pool, entao pode ser chamada por varias threads ao mesmo tempo. */
+uint32_t internBuscarTrecho(const InternPool *pool, const char *s, size_t len) {
+    if (len == 0) return ID_VAZIO;
+    Trecho t = { s, len };
+    HashSlot *slot = buscarSlot(&pool->indice, hashTrecho(s, len), igualTexto, pool, &t);
+    return slot ? slot->chave : ID_VAZIO;
+}
+
+/* internBuscar() – id de uma string ja internada, ou ID_VAZIO se ela nao existir */
+uint32_t internBuscar(const InternPool *pool, const char *s) {
+    return internBuscarTrecho(pool, s, strlen(s));
+}
+
+/* texto de um id do pool */
+const char* internTexto(const InternPool *pool, uint32_t id) {
+    return pool->texto + pool->inicio[id];
+}
+
+void internLiberar(InternPool *pool) {
+    free(pool->texto);
+    free(pool->inicio);
+    liberarHash(&pool->indice);
+    pool->texto = NULL;
+    pool->inicio = NULL;
+    pool->tamTexto = pool->capTexto = 0;
+    pool->quantidade = pool->capIds = 0;
+}
+
+/* assinarPool() – registra a assinatura do conteudo atual (hash de todo o texto) */
+void assinarPool(InternPool *pool) {
+    pool->assinatura.tamTexto = pool->tamTexto;
+    pool->assinatura.numIds = pool->quantidade;
+    pool->assinatura.hashTexto = hashTrecho(pool->texto, pool->tamTexto);
+}
+
+/* mesmaAssinatura() – 1 se as duas assinaturas descrevem o mesmo pool */
+int mesmaAssinatura(const AssinaturaPool *a, const AssinaturaPool *b) {
+    return a->tamTexto == b->tamTexto && a->numIds == b->numIds && a->hashTexto == b->hashTexto;
+}
+
+/* linha do relatorio de memoria para o pool */
+void relatarIntern(const InternPool *pool) {
+    size_t bytes = pool->tamTexto + pool->quantidade * sizeof(uint32_t) +
+                   pool->indice.capacidade * sizeof(HashSlot);
+    relatarLinha("strings", pool->quantidade, bytes,
+                 pool->capTexto + pool->capIds * sizeof(uint32_t) + pool->indice.capacidade * sizeof(HashSlot), 3);
+}
+
+/* ===========================
+   FUNCOES DE SALA (MANSÃO)
+   =========================== */
+
+/*
+ * preencherSala() – inicializa um comodo ja alocado com nome e pista (ids do pool;
+ * pista pode ser ID_VAZIO). Os ponteiros esq/dir sao ligados depois pelo carregador.
+ */
+void preencherSala(Sala *s, uint32_t nome, uint32_t pista) {
+    s->nome = nome;
+    s->pista = pista;
+    s->esq = s->dir = NULL;
+}
+
+/* ===========================
+   FUNCOES DA BST DE PISTAS (AVL)
+   =========================== */
+
+void desmapearArquivo(const unsigned char *dados, size_t tam); /* nos vindos de um snapshot */
+
+/* compara duas pistas pelo texto; ids iguais sao a mesma pista e dispensam o strcmp */
+static int compararPistas(const InternPool *pool, uint32_t a, uint32_t b) {
+    if (a == b) return 0;
+    return strcmp(internTexto(pool, a), internTexto(pool, b));
+}
+
+static int32_t alturaNo(const ArvorePistas *arv, uint32_t n) {
+    return arv->nos[n].altura; /* o no sentinela 0 tem altura 0 */
+}
+
+static void atualizarAltura(ArvorePistas *arv, uint32_t n) {
+    int32_t he = alturaNo(arv, arv->nos[n].esq);
+    int32_t hd = alturaNo(arv, arv->nos[n].dir);
+    arv->nos[n].altura = 1 + (he > hd ? he : hd);
+}
+
+static uint32_t rotacionarDireita(ArvorePistas *arv, uint32_t n) {
+    uint32_t x = arv->nos[n].esq;
+    arv->nos[n].esq = arv->nos[x].dir;
+    arv->nos[x].dir = n;
+    atualizarAltura(arv, n);
+    atualizarAltura(arv, x);
+    return x;
+}
+
+static uint32_t rotacionarEsquerda(ArvorePistas *arv, uint32_t n) {
+    uint32_t x = arv->nos[n].dir;
+    arv->nos[n].dir = arv->nos[x].esq;
+    arv->nos[x].esq = n;
+    atualizarAltura(arv, n);
+    atualizarAltura(arv, x);
+    return x;
+}
+
+/* recalcula a altura de 'n' e faz as rotacoes necessarias; retorna a nova raiz da subarvore */
+static uint32_t balancear(ArvorePistas *arv, uint32_t n) {
+    atualizarAltura(arv, n);
+    int32_t fator = alturaNo(arv, arv->nos[n].esq) - alturaNo(arv, arv->nos[n].dir);
+    if (fator > 1) {
+        uint32_t e = arv->nos[n].esq;
+        if (alturaNo(arv, arv->nos[e].esq) < alturaNo(arv, arv->nos[e].dir))
+            arv->nos[n].esq = rotacionarEsquerda(arv, e);
+        return rotacionarDireita(arv, n);
+    }
+    if (fator < -1) {
+        uint32_t d = arv->nos[n].dir;
+        if (alturaNo(arv, arv->nos[d].dir) < alturaNo(arv, arv->nos[d].esq))
+            arv->nos[n].dir = rotacionarDireita(arv, d);
+        return rotacionarEsquerda(arv, n);
+    }
+    return n;
+}
+
+/* inicializa a arvore vazia (so com o no sentinela 0) */
+void iniciarArvorePistas(ArvorePistas *arv) {
+    arv->capacidade = 16;
+    arv->nos = (PistaNode*) malloc(arv->capacidade * sizeof(PistaNode));
+    if (!arv->nos) {
+        fprintf(stderr, "Erro: falha ao alocar memoria para PistaNode\n");
+        exit(1);
+    }
+    memset(&arv->nos[0], 0, sizeof(PistaNode));
+    arv->quantidade = 1;
+    arv->raiz = NO_NULO;
+    arv->mapa = NULL;
+    arv->tamMapa = 0;
+}
+
+/*
+ * inserirPista() – insere a pista coletada na arvore AVL de forma ordenada.
+ * Ignora duplicatas (nao insere duas vezes a mesma pista).
+ * Iterativa: desce guardando o caminho e rebalanceia de baixo para cima.
+ * Retorna 1 se a pista era nova.
+ */
+int inserirPista(ArvorePistas *arv, const InternPool *pool, uint32_t pista) {
+    if (pista == ID_VAZIO) return 0; /* nada a inserir */
+
+    uint32_t caminho[AVL_ALTURA_MAX];
+    int lado[AVL_ALTURA_MAX]; /* 0 = desceu a esquerda, 1 = a direita */
+    int prof = 0;
+    for (uint32_t n = arv->raiz; n != NO_NULO; prof++) {
+        int cmp = compararPistas(pool, pista, arv->nos[n].pista);
+        if (cmp == 0) return 0; /* duplicata: nao insere novamente */
+        caminho[prof] = n;
+        lado[prof] = cmp > 0;
+        n = cmp < 0 ? arv->nos[n].esq : arv->nos[n].dir;
+    }
+
+    if (arv->quantidade == arv->capacidade) {
+        size_t cap = (size_t) arv->capacidade * 2;
+        /* nos vindos de um snapshot: a primeira expansao os copia para o heap */
+        PistaNode *novos = arv->mapa ? (PistaNode*) malloc(cap * sizeof(PistaNode))
+                                     : (PistaNode*) realloc(arv->nos, cap * sizeof(PistaNode));
+        if (!novos || cap > UINT32_MAX) {
+            fprintf(stderr, "Erro: falha ao alocar memoria para PistaNode\n");
+            exit(1);
+        }
+        if (arv->mapa) {
+            memcpy(novos, arv->nos, arv->quantidade * sizeof(PistaNode));
+            desmapearArquivo(arv->mapa, arv->tamMapa);
+            arv->mapa = NULL;
+        }
+        arv->nos = novos;
+        arv->capacidade = (uint32_t) cap;
+    }
+    uint32_t novo = arv->quantidade++;
+    arv->nos[novo].pista = pista;
+    arv->nos[novo].esq = arv->nos[novo].dir = NO_NULO;
+    arv->nos[novo].altura = 1;
+
+    /* religa de baixo para cima, rebalanceando cada ancestral */
+    uint32_t filho = novo;
+    for (int i = prof - 1; i >= 0; i--) {
+        uint32_t n = caminho[i];
+        if (lado[i]) arv->nos[n].dir = filho;
+        else arv->nos[n].esq = filho;
+        filho = balancear(arv, n);
+    }
+    arv->raiz = filho;
+    return 1;
+}
+
+/* percorre a arvore em ordem e para cada pista chama uma funcao callback(pista, ctx)
+   usada para exibicao e contagem por suspeito (iterativo, com pilha explicita) */
+typedef void (*PistaCallback)(uint32_t pista, void *ctx);
+
+void bst_traverse_inorder(const ArvorePistas *arv, PistaCallback cb, void *ctx) {
+    uint32_t pilha[AVL_ALTURA_MAX];
+    int topo = 0;
+    uint32_t n = arv->raiz;
+    while (n != NO_NULO || topo > 0) {
+        while (n != NO_NULO) {
+            pilha[topo++] = n;
+            n = arv->nos[n].esq;
+        }
+        n = pilha[--topo];
+        cb(arv->nos[n].pista, ctx);
+        n = arv->nos[n].dir;
+    }
+}
+
+static void exibir_callback(uint32_t pista, void *ctx) {
+    printf(" - %s\n", internTexto((const InternPool*) ctx, pista));
+}
+
+/* exibe as pistas da arvore em ordem (alfabetica) */
+void exibirPistas(const InternPool *pool, const ArvorePistas *arv) {
+    bst_traverse_inorder(arv, exibir_callback, (void*) pool);
+}
+
+/* libera o vetor de nos */
+void liberarArvorePistas(ArvorePistas *arv) {
+    if (arv->mapa) desmapearArquivo(arv->mapa, arv->tamMapa);
+    else free(arv->nos);
+    arv->mapa = NULL;
+    arv->nos = NULL;
+    arv->quantidade = arv->capacidade = 0;
+    arv->raiz = NO_NULO;
+}
+
+/* linha do relatorio de memoria para a arvore (o no sentinela nao conta) */
+void relatarArvorePistas(const ArvorePistas *arv) {
+    relatarLinha("PistaNode", arv->quantidade - 1, (arv->quantidade - 1) * sizeof(PistaNode),
+                 arv->capacidade * sizeof(PistaNode), 1);
+}
+
+/* ===========================
+   CARREGADOR DE MANSAO (arquivo texto ou binario)
+   =========================== */
+
+/*
+ * Formato texto (DQ1), um registro por linha:
+ *   DQ1 <salas> <associacoes>
+ *   S <esq> <dir> <nome>|<pista>     salas em ordem de indice (0 = raiz, -1 = sem filho)
+ *   H <pista>|<suspeito>             associacao pista -> suspeito
+ * Linhas vazias ou iniciadas por '#' sao ignoradas.
+ *
+ * Formato binario (DQB1): "DQB1", uint32 salas, uint32 associacoes; cada sala como
+ * int32 esq, int32 dir, uint8 tamNome, nome, uint8 tamPista, pista; cada associacao
+ * como uint8 tamPista, pista, uint8 tamSuspeito, suspeito (ordem de bytes da maquina).
+ *
+ * O arquivo inteiro e mapeado em memoria e lido numa unica passada; o cabecalho
+ * informa as quantidades, entao o vetor de salas e a hash sao alocados uma vez so.
+ */
+
+/* mansao padrao do jogo, lida pelo mesmo carregador */
+static const char MANSAO_PADRAO[] =
+    "DQ1 8 8\n"
+    "S 1 2 Hall de Entrada|Pegadas sujas perto da janela\n"
+    "S 3 4 Sala de Estar|Retrato pendurado torto\n"
+    "S 5 6 Cozinha|Vasilha quebrada no chao\n"
+    "S -1 -1 Biblioteca|Livro com anotacoes na margem\n"
+    "S -1 -1 Escritorio|Caneta com tinta vermelha\n"
+    "S -1 -1 Quarto|Fio de tecido azul\n"
+    "S -1 7 Sotao|Chave enferrujada\n"
+    "S -1 -1 Jardim|Pegadas que levam ao portao\n"
+    "H Pegadas sujas perto da janela|Sr. Black\n"
+    "H Retrato pendurado torto|Sra. White\n"
+    "H Vasilha quebrada no chao|Jovem Green\n"
+    "H Livro com anotacoes na margem|Prof. Plum\n"
+    "H Caneta com tinta vermelha|Sra. White\n"
+    "H Fio de tecido azul|Jovem Green\n"
+    "H Chave enferrujada|Sr. Black\n"
+    "H Pegadas que levam ao portao|Sr. Black\n";
+
+/* cursor sobre o conteudo mapeado; os textos lidos vao direto para o pool */
+typedef struct {
+    const unsigned char *p;
+    const unsigned char *fim;
+    const char *origem;
+    size_t linha;
+    InternPool *pool;
+} Leitor;
+
+static int erroCarga(const Leitor *l, const char *msg) {
+    if (l->linha) fprintf(stderr, "Erro: %s, linha %zu: %s\n", l->origem, l->linha, msg);
+    else fprintf(stderr, "Erro: %s: %s\n", l->origem, msg);
+    return 0;
+}
+
+static void pularEspacos(Leitor *l) {
+    while (l->p < l->fim && (*l->p == ' ' || *l->p == '\t')) l->p++;
+}
+
+static void proximaLinha(Leitor *l) {
+    const unsigned char *nl = memchr(l->p, '\n', (size_t)(l->fim - l->p));
+    l->p = nl ? nl + 1 : l->fim;
+}
+
+static int lerInteiro(Leitor *l, long *v) {
+    pularEspacos(l);
+    int negativo = 0;
+    if (l->p < l->fim && *l->p == '-') {
+        negativo = 1;
+        l->p++;
+    }
+    if (l->p >= l->fim || !isdigit(*l->p)) return 0;
+    long x = 0;
+    while (l->p < l->fim && isdigit(*l->p)) {
+        if (x > 100000000L) return 0; /* muito grande para um indice de sala */
+        x = x * 10 + (*l->p++ - '0');
+    }
+    *v = negativo ? -x : x;
+    return 1;
+}
+
+/* le um campo ate 'sep' (consumido) ou, com sep == '\n', ate o fim da linha.
+   Retorna o inicio do campo ou NULL se o separador nao aparecer na linha. */
+static const char* lerCampo(Leitor *l, char sep, size_t *len) {
+    pularEspacos(l);
+    const unsigned char *ini = l->p;
+    size_t resto = (size_t)(l->fim - l->p);
+    const unsigned char *nl = memchr(ini, '\n', resto);
+    const unsigned char *fimLinha = nl ? nl : l->fim;
+    const unsigned char *fimCampo = fimLinha;
+    if (sep != '\n') {
+        fimCampo = memchr(ini, sep, (size_t)(fimLinha - ini));
+        if (!fimCampo) return NULL;
+        l->p = fimCampo + 1;
+    } else {
+        l->p = fimLinha;
+        if (fimCampo > ini && fimCampo[-1] == '\r') fimCampo--;
+    }
+    *len = (size_t)(fimCampo - ini);
+    return (const char*) ini;
+}
+
+/* liga a sala 'i' aos filhos; cada sala pode ter um unico pai e a raiz nenhum */
+static int ligarSala(Leitor *l, Mansao *m, unsigned char *temPai, size_t i, long esq, long dir) {
+    long filhos[2] = { esq, dir };
+    Sala **destino[2] = { &m->salas[i].esq, &m->salas[i].dir };
+    for (int k = 0; k < 2; k++) {
+        long f = filhos[k];
+        if (f < 0) continue;
+        if (f == 0 || (size_t)f >= m->quantidade) return erroCarga(l, "indice de sala invalido");
+        if (temPai[f]) return erroCarga(l, "sala ligada a mais de um pai");
+        temPai[f] = 1;
+        *destino[k] = &m->salas[f];
+    }
+    return 1;
+}
+
+/* interna um campo lido, truncado em 'max' - 1 bytes como nos limites originais */
+static uint32_t internarCampo(Leitor *l, const char *s, size_t len, size_t max) {
+    return internar(l->pool, s, len < max ? len : max - 1);
+}
+
+/* aloca o vetor de salas a partir das quantidades do cabecalho */
+static int prepararMansao(Leitor *l, Arena *arena, Mansao *m, HashTable *ht,
+                          long salas, long assoc, size_t tamMinSala) {
+    if (salas < 1 || assoc < 0) return erroCarga(l, "cabecalho invalido");
+    /* um cabecalho maior que o proprio arquivo indica arquivo corrompido */
+    if ((size_t)salas > (size_t)(l->fim - l->p) / tamMinSala) return erroCarga(l, "quantidade de salas maior que o arquivo");
+    m->quantidade = (size_t) salas;
+    m->salas = (Sala*) arenaAlocarVetor(arena, sizeof(Sala), m->quantidade);
+    if (ht) reservarHash(ht, (size_t) assoc);
+    /* o texto nunca passa do tamanho do arquivo; ids: no maximo nome + pista por sala */
+    internReservar(l->pool, m->quantidade + (size_t) assoc, (size_t)(l->fim - l->p));
+    return 1;
+}
+
+static int carregarTexto(Leitor *l, Arena *arena, Mansao *m, HashTable *ht, unsigned char **temPai) {
+    long nSalas, nAssoc;
+    l->linha = 1;
+    l->p += 3; /* "DQ1" */
+    if (!lerInteiro(l, &nSalas) || !lerInteiro(l, &nAssoc)) return erroCarga(l, "cabecalho invalido");
+    proximaLinha(l);
+    if (!prepararMansao(l, arena, m, ht, nSalas, nAssoc, 8)) return 0;
+    *temPai = (unsigned char*) calloc(m->quantidade, 1);
+    if (!*temPai) {
+        fprintf(stderr, "Erro: falha na alocacao\n");
+        exit(1);
+    }
+
+    size_t salas = 0, assoc = 0;
+    while (l->p < l->fim) {
+        l->linha++;
+        unsigned char c = *l->p;
+        if (c == '\n' || c == '\r' || c == '#') {
+            proximaLinha(l);
+            continue;
+        }
+        l->p++;
+        size_t len1, len2;
+        const char *campo1, *campo2;
+        if (c == 'S') {
+            long esq, dir;
+            if (salas >= m->quantidade) return erroCarga(l, "mais salas que o declarado");
+            if (!lerInteiro(l, &esq) || !lerInteiro(l, &dir)) return erroCarga(l, "indices de sala invalidos");
+            campo1 = lerCampo(l, '|', &len1);
+            if (!campo1) return erroCarga(l, "esperado '<nome>|<pista>'");
+            campo2 = lerCampo(l, '\n', &len2);
+            preencherSala(&m->salas[salas], internarCampo(l, campo1, len1, MAX_NOME),
+                          internarCampo(l, campo2, len2, MAX_PISTA));
+            if (!ligarSala(l, m, *temPai, salas, esq, dir)) return 0;
+            salas++;
+        } else if (c == 'H') {
+            if (assoc >= (size_t) nAssoc) return erroCarga(l, "mais associacoes que o declarado");
+            campo1 = lerCampo(l, '|', &len1);
+            if (!campo1) return erroCarga(l, "esperado '<pista>|<suspeito>'");
+            campo2 = lerCampo(l, '\n', &len2);
+            uint32_t pista = internarCampo(l, campo1, len1, MAX_PISTA);
+            uint32_t suspeito = internarCampo(l, campo2, len2, MAX_NOME);
+            if (ht) inserirNaHash(ht, pista, suspeito);
+            assoc++;
+        } else {
+            return erroCarga(l, "registro desconhecido (esperado 'S' ou 'H')");
+        }
+        proximaLinha(l);
+    }
+    l->linha = 0;
+    if (salas != m->quantidade) return erroCarga(l, "menos salas que o declarado no cabecalho");
+    if (assoc != (size_t) nAssoc) return erroCarga(l, "menos associacoes que o declarado no cabecalho");
+    return 1;
+}
+
+static int lerBytes(Leitor *l, void *dest, size_t n) {
+    if ((size_t)(l->fim - l->p) < n) return 0;
+    memcpy(dest, l->p, n);
+    l->p += n;
+    return 1;
+}
+
+/* le um texto prefixado por tamanho (uint8); o texto fica no proprio mapeamento */
+static const char* lerTextoBinario(Leitor *l, size_t *len) {
+    uint8_t n;
+    if (!lerBytes(l, &n, 1) || (size_t)(l->fim - l->p) < n) return NULL;
+    const char *ini = (const char*) l->p;
+    l->p += n;
+    *len = n;
+    return ini;
+}
+
+static int carregarBinario(Leitor *l, Arena *arena, Mansao *m, HashTable *ht, unsigned char **temPai) {
+    uint32_t nSalas, nAssoc;
+    l->p += 4; /* "DQB1" */
+    if (!lerBytes(l, &nSalas, 4) || !lerBytes(l, &nAssoc, 4)) return erroCarga(l, "cabecalho truncado");
+    if (!prepararMansao(l, arena, m, ht, (long) nSalas, (long) nAssoc, 10)) return 0;
+    *temPai = (unsigned char*) calloc(m->quantidade, 1);
+    if (!*temPai) {
+        fprintf(stderr, "Erro: falha na alocacao\n");
+        exit(1);
+    }
+    for (size_t i = 0; i < m->quantidade; i++) {
+        int32_t esq, dir;
+        size_t lenNome, lenPista;
+        const char *nome, *pista;
+        if (!lerBytes(l, &esq, 4) || !lerBytes(l, &dir, 4)) return erroCarga(l, "sala truncada");
+        if (!(nome = lerTextoBinario(l, &lenNome)) || !(pista = lerTextoBinario(l, &lenPista)))
+            return erroCarga(l, "sala truncada");
+        preencherSala(&m->salas[i], internarCampo(l, nome, lenNome, MAX_NOME),
+                      internarCampo(l, pista, lenPista, MAX_PISTA));
+        if (!ligarSala(l, m, *temPai, i, esq, dir)) return 0;
+    }
+    for (uint32_t i = 0; i < nAssoc; i++) {
+        size_t lenPista, lenSuspeito;
+        const char *pista, *suspeito;
+        if (!(pista = lerTextoBinario(l, &lenPista)) || !(suspeito = lerTextoBinario(l, &lenSuspeito)))
+            return erroCarga(l, "associacao truncada");
+        uint32_t idPista = internarCampo(l, pista, lenPista, MAX_PISTA);
+        uint32_t idSuspeito = internarCampo(l, suspeito, lenSuspeito, MAX_NOME);
+        if (ht) inserirNaHash(ht, idPista, idSuspeito);
+    }
+    return 1;
+}
+
+/*
+ * carregarMansaoMemoria() – monta a mansao e a hash a partir do conteudo de um
+ * arquivo ja em memoria (texto DQ1 ou binario DQB1). As salas saem de 'arena' e
+ * os textos vao para 'pool' (em caso de erro, o que ja foi alocado fica na arena
+ * ate o proximo reset). Com 'ht' NULL as associacoes so tem os textos internados,
+ * na mesma ordem, e o mapa fica para uma base em disco. Retorna 1 em sucesso.
+ */
+int carregarMansaoMemoria(const unsigned char *dados, size_t tam, const char *origem,
+                          Arena *arena, InternPool *pool, Mansao *m, HashTable *ht) {
+    Leitor l = { dados, dados + tam, origem, 0, pool };
+    unsigned char *temPai = NULL;
+    int ok;
+    m->salas = NULL;
+    m->quantidade = 0;
+    if (tam >= 4 && memcmp(dados, "DQB1", 4) == 0) ok = carregarBinario(&l, arena, m, ht, &temPai);
+    else if (tam >= 3 && memcmp(dados, "DQ1", 3) == 0) ok = carregarTexto(&l, arena, m, ht, &temPai);
+    else ok = erroCarga(&l, "formato desconhecido (esperado DQ1 ou DQB1)");
+    free(temPai);
+    if (!ok) {
+        m->salas = NULL;
+        m->quantidade = 0;
+    } else {
+        assinarPool(pool); /* sessoes e bases comparam com ela sem reler o texto */
+    }
+    return ok;
+}
+
+/*
+ * mapearArquivoModo() – mapeia o arquivo inteiro (no Windows, le para um
+ * buffer). 'gravavel' pede copia na escrita: alteracoes ficam so na memoria.
+ * Retorna NULL (com mensagem) em erro ou arquivo vazio.
+ */
+static unsigned char* mapearArquivoModo(const char *caminho, size_t *tam, int gravavel) {
+#ifndef _WIN32
+    int fd = open(caminho, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || st.st_size == 0) {
+        fprintf(stderr, "Erro: nao foi possivel abrir '%s'\n", caminho);
+        if (fd >= 0) close(fd);
+        return NULL;
+    }
+    *tam = (size_t) st.st_size;
+    void *dados = mmap(NULL, *tam, gravavel ? PROT_READ | PROT_WRITE : PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (dados == MAP_FAILED) {
+        fprintf(stderr, "Erro: falha ao mapear '%s'\n", caminho);
+        return NULL;
+    }
+    if (!gravavel) posix_madvise(dados, *tam, POSIX_MADV_SEQUENTIAL);
+    return (unsigned char*) dados;
+#else
+    (void) gravavel;
+    FILE *f = fopen(caminho, "rb");
+    if (!f) {
+        fprintf(stderr, "Erro: nao foi possivel abrir '%s'\n", caminho);
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    long t = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    unsigned char *dados = (t > 0) ? (unsigned char*) malloc((size_t) t) : NULL;
+    int ok = dados && fread(dados, 1, (size_t) t, f) == (size_t) t;
+    fclose(f);
+    if (!ok) {
+        fprintf(stderr, "Erro: falha ao ler '%s'\n", caminho);
+        free(dados);
+        return NULL;
+    }
+    *tam = (size_t) t;
+    return dados;
+#endif
+}
+
+/* mapeia somente leitura, para percorrer em sequencia (cargas e lotes) */
+const unsigned char* mapearArquivo(const char *caminho, size_t *tam) {
+    return mapearArquivoModo(caminho, tam, 0);
+}
+
+/* mapeia com copia na escrita, para usar estruturas do arquivo no lugar */
+unsigned char* mapearArquivoGravavel(const char *caminho, size_t *tam) {
+    return mapearArquivoModo(caminho, tam, 1);
+}
+
+void desmapearArquivo(const unsigned char *dados, size_t tam) {
+#ifndef _WIN32
+    munmap((void*) dados, tam);
+#else
+    (void) tam;
+    free((void*) dados);
+#endif
+}
+
+/* carregarMansao() – mapeia o arquivo e delega a carregarMansaoMemoria() */
+int carregarMansao(const char *caminho, Arena *arena, InternPool *pool, Mansao *m, HashTable *ht) {
+    size_t tam;
+    const unsigned char *dados = mapearArquivo(caminho, &tam);
+    if (!dados) return 0;
+    int ok = carregarMansaoMemoria(dados, tam, caminho, arena, pool, m, ht);
+    desmapearArquivo(dados, tam);
+    return ok;
+}
+
+static void escreverTextoBinario(FILE *f, const char *s) {
+    uint8_t n = (uint8_t) strlen(s);
+    fwrite(&n, 1, 1, f);
+    fwrite(s, 1, n, f);
+}
+
+/* salvarMansaoBinaria() – grava mansao e associacoes no formato DQB1. Retorna 1 em sucesso. */
+int salvarMansaoBinaria(const char *caminho, const Mansao *m, const HashTable *ht, const InternPool *pool) {
+    FILE *f = fopen(caminho, "wb");
+    if (!f) {
+        fprintf(stderr, "Erro: nao foi possivel criar '%s'\n", caminho);
+        return 0;
+    }
+    uint32_t nSalas = (uint32_t) m->quantidade;
+    uint32_t nAssoc = (uint32_t) ht->quantidade;
+    fwrite("DQB1", 1, 4, f);
+    fwrite(&nSalas, 4, 1, f);
+    fwrite(&nAssoc, 4, 1, f);
+    for (size_t i = 0; i < m->quantidade; i++) {
+        const Sala *s = &m->salas[i];
+        int32_t esq = s->esq ? (int32_t)(s->esq - m->salas) : -1;
+        int32_t dir = s->dir ? (int32_t)(s->dir - m->salas) : -1;
+        fwrite(&esq, 4, 1, f);
+        fwrite(&dir, 4, 1, f);
+        escreverTextoBinario(f, internTexto(pool, s->nome));
+        escreverTextoBinario(f, internTexto(pool, s->pista));
+    }
+    for (size_t i = 0; i < ht->capacidade; i++) {
+        if (!ht->slots[i].hash) continue;
+        escreverTextoBinario(f, internTexto(pool, ht->slots[i].chave));
+        escreverTextoBinario(f, internTexto(pool, ht->slots[i].valor));
+    }
+    int ok = !ferror(f);
+    if (fclose(f) != 0) ok = 0;
+    if (!ok) fprintf(stderr, "Erro: falha ao gravar '%s'\n", caminho);
+    return ok;
+}
+
+/* proximoAleatorio() – avanca o xorshift64 de estado '*x' (nunca zero) e devolve o novo valor */
+static inline uint64_t proximoAleatorio(uint64_t *x) {
+    *x ^= *x << 13;
+    *x ^= *x >> 7;
+    *x ^= *x << 17;
+    return *x;
+}
+
+/*
+ * gerarMansaoTexto() – escreve uma mansao aleatoria com 'n' salas no formato DQ1
+ * (uma pista distinta por sala, cada uma apontando para um suspeito sorteado).
+ * Usado para testar a carga de mansoes grandes.
+ */
+int gerarMansaoTexto(const char *caminho, size_t n, uint64_t semente) {
+    static const char *suspeitos[] = {
+        "Sr. Black", "Sra. White", "Jovem Green", "Prof. Plum", "Coronel Mustard", "Sra. Peacock"
+    };
+    const size_t nSuspeitos = sizeof(suspeitos) / sizeof(suspeitos[0]);
+    if (n == 0 || n > 100000000) {
+        fprintf(stderr, "Erro: quantidade de salas invalida\n");
+        return 0;
+    }
+    int32_t *filhos = (int32_t*) malloc(n * 2 * sizeof(int32_t));
+    uint32_t *livres = (uint32_t*) malloc(n * 2 * sizeof(uint32_t));
+    if (!filhos || !livres) {
+        fprintf(stderr, "Erro: falha na alocacao\n");
+        exit(1);
+    }
+    /* cada sala nova ocupa uma posicao livre (esq/dir) sorteada entre as ja existentes */
+    uint64_t x = semente ? semente : 0x9E3779B97F4A7C15ULL;
+    size_t nLivres = 0;
+    for (size_t i = 0; i < n * 2; i++) filhos[i] = -1;
+    livres[nLivres++] = 0;
+    livres[nLivres++] = 1;
+    for (size_t i = 1; i < n; i++) {
+        size_t k = (size_t)(proximoAleatorio(&x) % nLivres);
+        filhos[livres[k]] = (int32_t) i;
+        livres[k] = livres[--nLivres];
+        livres[nLivres++] = (uint32_t)(i * 2);
+        livres[nLivres++] = (uint32_t)(i * 2 + 1);
+    }
+    free(livres);
+
+    FILE *f = fopen(caminho, "w");
+    if (!f) {
+        fprintf(stderr, "Erro: nao foi possivel criar '%s'\n", caminho);
+        free(filhos);
+        return 0;
+    }
+    fprintf(f, "DQ1 %zu %zu\n", n, n);
+    for (size_t i = 0; i < n; i++)
+        fprintf(f, "S %d %d Sala %zu|Pista %zu\n", filhos[i * 2], filhos[i * 2 + 1], i, i);
+    for (size_t i = 0; i < n; i++) {
+        fprintf(f, "H Pista %zu|%s\n", i, suspeitos[proximoAleatorio(&x) % nSuspeitos]);
+    }
+    free(filhos);
+    int ok = !ferror(f);
+    if (fclose(f) != 0) ok = 0;
+    if (!ok) fprintf(stderr, "Erro: falha ao gravar '%s'\n", caminho);
+    return ok;
+}
+
+/* tempo monotonico em segundos */
+static double agoraSegundos(void) {
+#ifndef _WIN32
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + ts.tv_nsec / 1e9;
+#else
+    return (double) clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+/* pico de memoria residente do processo em KB (0 se indisponivel) */
+static long picoMemoriaKB(void) {
+#ifndef _WIN32
+    struct rusage uso;
+    if (getrusage(RUSAGE_SELF, &uso) == 0) return uso.ru_maxrss;
+#endif
+    return 0;
+}
+
+/* ===========================
+   SESSAO (gravar e retomar)
+   =========================== */
+
+/*
+ * Snapshot de uma investigacao (DQS1): cabecalho fixo seguido do vetor de
+ * PistaNode e das posicoes da contagem por suspeito, nos deslocamentos
+ * indicados no cabecalho. Filhos da arvore ja sao indices e pistas/suspeitos
+ * sao ids do pool, entao nada depende de enderecos: ao retomar, o arquivo e
+ * mapeado (copia na escrita) e a arvore passa a usar os nos mapeados como
+ * estao, sem reinserir pistas nem recalcular hashes. So a contagem (uma
+ * entrada por suspeito) e copiada. Os ids so valem para a mesma mansao, que
+ * e conferida pela assinatura do pool.
+ */
+
+#define SESSAO_MAGIA "DQS1"
+#define SESSAO_ALINHAMENTO 16
+
+typedef struct {
+    char magia[4];
+    uint32_t numSalas;        /* com a assinatura do pool, identifica a mansao */
+    AssinaturaPool pool;
+    uint32_t salaAtual;       /* indice em Mansao.salas */
+    uint32_t raiz;
+    uint32_t numNos;          /* inclui o sentinela */
+    uint32_t qtdContagem;
+    uint64_t capContagem;
+    uint64_t desNos;          /* deslocamento do vetor de PistaNode */
+    uint64_t desContagem;     /* deslocamento do vetor de HashSlot */
+} CabecalhoSessao;
+
+static size_t alinharSessao(size_t x) {
+    return (x + SESSAO_ALINHAMENTO - 1) & ~(size_t)(SESSAO_ALINHAMENTO - 1);
+}
+
+static void assinarSessao(CabecalhoSessao *c, const Mansao *m, const InternPool *pool) {
+    memcpy(c->magia, SESSAO_MAGIA, 4);
+    c->numSalas = (uint32_t) m->quantidade;
+    c->pool = pool->assinatura;
+}
+
+/*
+ * salvarSessao() – grava a investigacao e a sala atual em 'caminho'.
+ * Escreve num temporario e renomeia, para nunca deixar um snapshot pela metade.
+ * Retorna 1 em sucesso.
+ */
+int salvarSessao(const char *caminho, const Mansao *m, const InternPool *pool,
+                 const Investigacao *inv, uint32_t salaAtual) {
+    CabecalhoSessao c;
+    memset(&c, 0, sizeof(c));
+    assinarSessao(&c, m, pool);
+    c.salaAtual = salaAtual;
+    c.raiz = inv->pistas.raiz;
+    c.numNos = inv->pistas.quantidade;
+    c.qtdContagem = (uint32_t) inv->contagem.quantidade;
+    c.capContagem = inv->contagem.capacidade;
+    c.desNos = alinharSessao(sizeof(c));
+    c.desContagem = alinharSessao(c.desNos + (size_t) c.numNos * sizeof(PistaNode));
+
+    size_t lenTmp = strlen(caminho) + 5;
+    char *tmp = (char*) malloc(lenTmp);
+    if (!tmp) {
+        fprintf(stderr, "Erro: falha ao alocar nome do snapshot\n");
+        exit(1);
+    }
+    snprintf(tmp, lenTmp, "%s.tmp", caminho);
+    FILE *f = fopen(tmp, "wb");
+    if (!f) {
+        fprintf(stderr, "Erro: nao foi possivel criar '%s'\n", tmp);
+        free(tmp);
+        return 0;
+    }
+    static const unsigned char zeros[SESSAO_ALINHAMENTO];
+    fwrite(&c, sizeof(c), 1, f);
+    fwrite(zeros, 1, c.desNos - sizeof(c), f);
+    fwrite(inv->pistas.nos, sizeof(PistaNode), c.numNos, f);
+    fwrite(zeros, 1, c.desContagem - (c.desNos + (size_t) c.numNos * sizeof(PistaNode)), f);
+    fwrite(inv->contagem.slots, sizeof(HashSlot), inv->contagem.capacidade, f);
+    int ok = !ferror(f);
+    if (fclose(f) != 0) ok = 0;
+    if (ok && rename(tmp, caminho) != 0) ok = 0;
+    if (!ok) {
+        fprintf(stderr, "Erro: falha ao gravar '%s'\n", caminho);
+        remove(tmp);
+    }
+    free(tmp);
+    return ok;
+}
+
+/*
+ * retomarSessao() – mapeia o snapshot e monta 'inv' (ainda nao iniciada) sobre
+ * ele; '*salaAtual' recebe a sala onde o jogador parou. O custo nao depende do
+ * numero de pistas coletadas. Retorna 1 em sucesso (com mensagem em erro).
+ */
+int retomarSessao(const char *caminho, const Mansao *m, const InternPool *pool,
+                  Investigacao *inv, uint32_t *salaAtual) {
+    size_t tam;
+    unsigned char *dados = mapearArquivoGravavel(caminho, &tam);
+    if (!dados) return 0;
+    CabecalhoSessao c, esperado;
+    const char *erro = NULL;
+    if (tam < sizeof(c)) {
+        erro = "arquivo truncado";
+    } else {
+        memcpy(&c, dados, sizeof(c));
+        assinarSessao(&esperado, m, pool);
+        if (memcmp(c.magia, SESSAO_MAGIA, 4) != 0)
+            erro = "formato desconhecido (esperado DQS1)";
+        else if (c.numSalas != esperado.numSalas || !mesmaAssinatura(&c.pool, &esperado.pool))
+            erro = "snapshot de outra mansao";
+        else if (c.salaAtual >= c.numSalas || c.numNos == 0 || c.raiz >= c.numNos ||
+                 c.capContagem == 0 || (c.capContagem & (c.capContagem - 1)) != 0 ||
+                 c.qtdContagem > c.capContagem ||
+                 c.desNos % _Alignof(PistaNode) != 0 || c.desContagem % _Alignof(HashSlot) != 0 ||
+                 c.desNos > tam || (tam - c.desNos) / sizeof(PistaNode) < c.numNos ||
+                 c.desContagem > tam || (tam - c.desContagem) / sizeof(HashSlot) < c.capContagem)
+            erro = "cabecalho invalido";
+    }
+    if (erro) {
+        fprintf(stderr, "Erro: %s: %s\n", caminho, erro);
+        desmapearArquivo(dados, tam);
+        return 0;
+    }
+
+    /* a arvore usa os nos do mapeamento; so a contagem vai para o heap */
+    inv->pistas.nos = (PistaNode*)(dados + c.desNos);
+    inv->pistas.quantidade = c.numNos;
+    inv->pistas.capacidade = c.numNos;
+    inv->pistas.raiz = c.raiz;
+    inv->pistas.mapa = dados;
+    inv->pistas.tamMapa = tam;
+    HashTable contagem = { (HashSlot*)(dados + c.desContagem), (size_t) c.capContagem, c.qtdContagem, NULL };
+    copiarHash(&inv->contagem, &contagem);
+    *salaAtual = c.salaAtual;
+    return 1;
+}
+
+/* ===========================
+   FUNCOES DE EXPLORACAO E JULGAMENTO
+   =========================== */
+
+void iniciarInvestigacao(Investigacao *inv) {
+    iniciarArvorePistas(&inv->pistas);
+    initHash(&inv->contagem);
+}
+
+void liberarInvestigacao(Investigacao *inv) {
+    liberarArvorePistas(&inv->pistas);
+    liberarHash(&inv->contagem);
+}
+
+/* esvazia a investigacao mantendo a memoria ja alocada */
+void reiniciarInvestigacao(Investigacao *inv) {
+    inv->pistas.quantidade = 1; /* so o sentinela */
+    inv->pistas.raiz = NO_NULO;
+    limparHash(&inv->contagem);
+}
+
+/*
+ * registrarPista() – adiciona a pista a investigacao; se ela for nova, soma um
+ * ao suspeito para quem aponta (pistas sem suspeito so entram na arvore).
+ * Retorna 1 se a pista era nova.
+ */
+int registrarPista(Investigacao *inv, const InternPool *pool, const HashTable *ht, uint32_t pista) {
+    if (!inserirPista(&inv->pistas, pool, pista)) return 0;
+    uint32_t suspeito = encontrarSuspeito(ht, pista);
+    if (suspeito != ID_VAZIO) somarNaHash(&inv->contagem, suspeito, 1);
+    return 1;
+}
+
+/* grava a sessao (se o jogo foi iniciado com um arquivo de sessao) */
+static void gravarSessaoJogo(const char *arqSessao, const Mansao *m, const InternPool *pool,
+                             const Investigacao *inv, const Sala *atual) {
+    if (arqSessao && salvarSessao(arqSessao, m, pool, inv, (uint32_t)(atual - m->salas)))
+        printf("Sessao gravada em '%s'.\n", arqSessao);
+}
+
+/*
+ * explorarSalas() – navega pela arvore interativamente a partir de 'inicio'
+ * (o hall, ou a sala de uma sessao retomada).
+ * Para cada sala visitada, exibe a pista (se houver) e adiciona a BST de pistas
+ * e atualiza a contagem por suspeito (textos vindos do 'pool', associacoes de 'ht').
+ * Com 'arqSessao', o comando 'g' e a saida gravam a sessao para ser retomada.
+ */
+void explorarSalas(const Mansao *m, Sala *inicio, const InternPool *pool, const HashTable *ht,
+                   Investigacao *inv, const char *arqSessao) {
+    if (!inicio) return;
+
+    Sala *atual = inicio;
+    char linha[32];
+
+    printf("Iniciando exploracao (comandos: e = esquerda, d = direita, %ss = sair)\n",
+           arqSessao ? "g = gravar sessao, " : "");
+
+    while (atual) {
+        printf("\nVoce entrou em: %s\n", internTexto(pool, atual->nome));
+        if (atual->pista != ID_VAZIO) {
+            printf("Pista encontrada: \"%s\"\n", internTexto(pool, atual->pista));
+            registrarPista(inv, pool, ht, atual->pista);
+        } else {
+            printf("Nenhuma pista nesta sala.\n");
+        }
+
+        /* se folha, apenas permitir voltar? No enunciado, nao tem voltar, apenas seguir ate sair
+           entao oferecemos opcoes conforme filhos existentes */
+        if (atual->esq == NULL && atual->dir == NULL) {
+            printf("Esta sala nao possui caminhos (no folha). Voce pode sair (s) ou encerrar exploracao.\n");
+            printf("Digite 's' para sair ou outra tecla para encerrar exploracao: ");
+            if (!fgets(linha, sizeof(linha), stdin)) break;
+            if (tolower((unsigned char)linha[0]) == 's') {
+                printf("Exploracao encerrada pelo jogador.\n");
+            }
+            gravarSessaoJogo(arqSessao, m, pool, inv, atual);
+            break;
+        }
+
+        printf("Escolha um caminho:\n");
+        if (atual->esq) printf("  (e) esquerda -> %s\n", internTexto(pool, atual->esq->nome));
+        else printf("  (e) esquerda -> (bloqueado)\n");
+        if (atual->dir) printf("  (d) direita -> %s\n", internTexto(pool, atual->dir->nome));
+        else printf("  (d) direita -> (bloqueado)\n");
+        if (arqSessao) printf("  (g) gravar sessao\n");
+        printf("  (s) sair da exploracao\n");
+        printf("Opcao: ");
+        if (!fgets(linha, sizeof(linha), stdin)) break;
+        char c = tolower((unsigned char)linha[0]);
+        if (c == 'e') {
+            if (atual->esq) atual = atual->esq;
+            else printf("Caminho a esquerda indisponivel.\n");
+        } else if (c == 'd') {
+            if (atual->dir) atual = atual->dir;
+            else printf("Caminho a direita indisponivel.\n");
+        } else if (c == 'g' && arqSessao) {
+            gravarSessaoJogo(arqSessao, m, pool, inv, atual);
+        } else if (c == 's') {
+            printf("Exploracao encerrada pelo jogador.\n");
+            gravarSessaoJogo(arqSessao, m, pool, inv, atual);
+            break;
+        } else {
+            printf("Comando invalido. Digite 'e', 'd'%s ou 's'.\n", arqSessao ? ", 'g'" : "");
+        }
+    }
+}
+
+/*
+ * verificarSuspeitoFinal() – verifica se ha pelo menos duas pistas que apontam
+ * para o suspeito indicado pelo jogador.
+ * Retorna número de pistas que apontam para ele.
+ * Observação: a contagem por suspeito ja foi mantida por registrarPista(), entao
+ * a verificacao e uma unica consulta na hash, independente do numero de pistas.
+ */
+int verificarSuspeitoFinal(const Investigacao *inv, uint32_t acusado) {
+    if (acusado == ID_VAZIO) return 0;
+    return (int) encontrarSuspeito(&inv->contagem, acusado); /* ID_VAZIO == 0 pistas */
+}
+
+/* suspeito e contagem usados na ordenacao do ranking */
+typedef struct {
+    const char *nome;
+    uint32_t pistas;
+} LinhaRanking;
+
+static int compararRanking(const void *a, const void *b) {
+    const LinhaRanking *x = (const LinhaRanking*) a;
+    const LinhaRanking *y = (const LinhaRanking*) b;
+    if (x->pistas != y->pistas) return x->pistas < y->pistas ? 1 : -1;
+    return strcmp(x->nome, y->nome);
+}
+
+static int compararNomeRanking(const void *a, const void *b) {
+    return strcmp(((const LinhaRanking*) a)->nome, ((const LinhaRanking*) b)->nome);
+}
+
+/* montarRanking() – suspeitos da investigacao ordenados por pistas (vetor a liberar; NULL se vazio) */
+size_t montarRanking(const Investigacao *inv, const InternPool *pool, LinhaRanking **saida) {
+    size_t n = inv->contagem.quantidade;
+    *saida = NULL;
+    if (n == 0) return 0;
+    LinhaRanking *linhas = (LinhaRanking*) malloc(n * sizeof(LinhaRanking));
+    if (!linhas) {
+        fprintf(stderr, "Erro: falha na alocacao do ranking\n");
+        exit(1);
+    }
+    size_t k = 0;
+    for (size_t i = 0; i < inv->contagem.capacidade; i++) {
+        const HashSlot *slot = &inv->contagem.slots[i];
+        if (!slot->hash) continue;
+        linhas[k].nome = internTexto(pool, slot->chave);
+        linhas[k].pistas = slot->valor;
+        k++;
+    }
+    qsort(linhas, k, sizeof(LinhaRanking), compararRanking);
+    *saida = linhas;
+    return k;
+}
+
+/* exibirRanking() – lista os suspeitos com pistas, do mais para o menos incriminado */
+void exibirRanking(const Investigacao *inv, const InternPool *pool) {
+    printf("\n== Ranking de suspeitos ==\n");
+    LinhaRanking *linhas;
+    size_t k = montarRanking(inv, pool, &linhas);
+    if (k == 0) {
+        printf("(Nenhuma pista aponta para um suspeito)\n");
+        return;
+    }
+    for (size_t i = 0; i < k; i++)
+        printf(" %zu. %s - %u pista(s)\n", i + 1, linhas[i].nome, linhas[i].pistas);
+    free(linhas);
+}
+
+/* ===========================
+   UTILITARIOS
+   =========================== */
+
+/* lista as pistas coletadas (in-order), ou mensagem se nao houver */
+void mostrarPistasColetadas(const InternPool *pool, const ArvorePistas *arvorePistas) {
+    printf("\n== Pistas coletadas ==\n");
+    if (arvorePistas->raiz == NO_NULO) {
+        printf("(Nenhuma pista coletada)\n");
+        return;
+    }
+    exibirPistas(pool, arvorePistas);
+}
+
+/* transforma uma string removendo newline no fim */
+void chomp(char *s) {
+    size_t L = strlen(s);
+    if (L == 0) return;
+    if (s[L-1] == '\n') s[L-1] = '\0';
+}
+
+/* ===========================
+   MANSAO COMPACTA E NAVEGACAO POR ROTEIRO
+   =========================== */
+
+/*
+ * compilarMansao() – copia a arvore de salas para vetores paralelos em ordem de
+ * largura (BFS): a raiz e o indice 0 e os irmaos ficam lado a lado, entao uma
+ * descida percorre memoria quase sequencial. Salas inalcancaveis a partir da
+ * raiz ficam de fora.
+ */
+void compilarMansao(const Mansao *m, MansaoCompacta *mc) {
+    size_t n = m->quantidade;
+    uint32_t *bloco = (uint32_t*) malloc(n * 4 * sizeof(uint32_t));
+    uint32_t *fila = (uint32_t*) malloc(n * sizeof(uint32_t));
+    if (!bloco || !fila) {
+        fprintf(stderr, "Erro: falha ao alocar mansao compacta\n");
+        exit(1);
+    }
+    mc->esq = bloco;
+    mc->dir = bloco + n;
+    mc->nome = bloco + 2 * n;
+    mc->pista = bloco + 3 * n;
+
+    /* a posicao de cada sala na fila e o seu novo indice */
+    uint32_t fim = 0;
+    fila[fim++] = 0;
+    for (uint32_t i = 0; i < fim; i++) {
+        const Sala *s = &m->salas[fila[i]];
+        mc->nome[i] = s->nome;
+        mc->pista[i] = s->pista;
+        mc->esq[i] = mc->dir[i] = SEM_FILHO;
+        if (s->esq) {
+            mc->esq[i] = fim;
+            fila[fim++] = (uint32_t)(s->esq - m->salas);
+        }
+        if (s->dir) {
+            mc->dir[i] = fim;
+            fila[fim++] = (uint32_t)(s->dir - m->salas);
+        }
+    }
+    mc->quantidade = fim;
+    free(fila);
+}
+
+void liberarMansaoCompacta(MansaoCompacta *mc) {
+    free(mc->esq); /* bloco unico */
+    mc->esq = mc->dir = mc->nome = mc->pista = NULL;
+    mc->quantidade = 0;
+}
+
+/*
+ * navegarCaminho() – executa um roteiro como "eedd" a partir da raiz, numa unica
+ * passada, registrando as pistas na investigacao como explorarSalas() faria.
+ * 'e'/'d' descem, 's' encerra; passos para caminho bloqueado ou comandos
+ * invalidos sao ignorados (o jogador fica na sala) e contados.
+ */
+ResultadoCaminho navegarCaminho(const MansaoCompacta *mc, const char *caminho,
+                                const InternPool *pool, const HashTable *ht, Investigacao *inv) {
+    ResultadoCaminho r = { 0, 0, 0 };
+    uint32_t atual = 0;
+    if (mc->pista[atual] != ID_VAZIO) registrarPista(inv, pool, ht, mc->pista[atual]);
+    for (const char *p = caminho; *p; p++) {
+        char c = (char) tolower((unsigned char) *p);
+        if (c == 's') break;
+        uint32_t prox = (c == 'e') ? mc->esq[atual] : (c == 'd') ? mc->dir[atual] : SEM_FILHO;
+        if (prox == SEM_FILHO) {
+            r.ignorados++;
+            continue;
+        }
+        atual = prox;
+        r.passos++;
+        if (mc->pista[atual] != ID_VAZIO) registrarPista(inv, pool, ht, mc->pista[atual]);
+    }
+    r.sala = atual;
+    return r;
+}
+
+/*
+ * executarCaminho() – modo nao interativo: compila a mansao, percorre o roteiro
+ * 'repeticoes' vezes (medindo o tempo por percurso) e mostra o resultado do
+ * ultimo percurso; com 'acusado' tambem julga a acusacao.
+ */
+void executarCaminho(const Mansao *m, const InternPool *pool, const HashTable *ht,
+                     const char *caminho, const char *acusado, long repeticoes) {
+    MansaoCompacta mc;
+    double t0 = agoraSegundos();
+    compilarMansao(m, &mc);
+    double t1 = agoraSegundos();
+
+    Investigacao inv;
+    iniciarInvestigacao(&inv);
+    ResultadoCaminho r = { 0, 0, 0 };
+    if (repeticoes < 1) repeticoes = 1;
+    for (long i = 0; i < repeticoes; i++) {
+        reiniciarInvestigacao(&inv);
+        r = navegarCaminho(&mc, caminho, pool, ht, &inv);
+    }
+    double t2 = agoraSegundos();
+    fprintf(stderr, "Mansao compacta: %u salas em %.2f ms; roteiro: %.0f ns por percurso (%ld percursos)\n",
+            mc.quantidade, (t1 - t0) * 1000.0, (t2 - t1) * 1e9 / (double) repeticoes, repeticoes);
+
+    printf("Roteiro '%s': %u passo(s), %u ignorado(s); parou em: %s\n",
+           caminho, r.passos, r.ignorados, internTexto(pool, mc.nome[r.sala]));
+    mostrarPistasColetadas(pool, &inv.pistas);
+    exibirRanking(&inv, pool);
+    if (acusado) {
+        int qtd = verificarSuspeitoFinal(&inv, internBuscar(pool, acusado));
+        printf("\nPistas que apontam para '%s': %d\n", acusado, qtd);
+        printf("Resultado: %s\n", qtd >= 2 ? "Ha evidencias suficientes. Acusacao sustentada!"
+                                           : "Evidencias insuficientes. Acusacao fragil.");
+    }
+    liberarInvestigacao(&inv);
+    liberarMansaoCompacta(&mc);
+}
+
+/* ===========================
+   SOLUCIONADOR: MENOR CAMINHO QUE INCRIMINA CADA SUSPEITO
+   =========================== */
+
+/*
+ * Para cada suspeito, a sala mais rasa cujo caminho desde a raiz coleta pelo
+ * menos duas pistas distintas que apontam para ele (a regra de main()).
+ * Numa arvore o caminho ate uma sala e unico, entao basta uma busca em
+ * profundidade iterativa sobre a mansao compacta mantendo:
+ *   - um bitset (por id de pista) das pistas ja presentes no caminho, para
+ *     contar cada pista uma vez so;
+ *   - um contador por suspeito, somado ao entrar na sala e desfeito ao sair.
+ * Custo O(salas), sem recursao; quando todos os suspeitos ja tem solucao, nao
+ * desce abaixo da profundidade da pior delas.
+ */
+
+#define PILHA_SAIDA 0x80000000u     /* marca de saida da sala na pilha da busca */
+#define PILHA_ADICIONOU 0x40000000u /* a sala acrescentou sua pista ao caminho */
+#define PILHA_INDICE 0x3FFFFFFFu
+#define SEM_SOLUCAO UINT32_MAX
+
+/* menor caminho encontrado para um suspeito */
+typedef struct {
+    uint32_t suspeito;      /* id do pool */
+    uint32_t sala;          /* indice na mansao compacta ou SEM_SOLUCAO */
+    uint32_t profundidade;  /* movimentos a partir da raiz */
+} SolucaoSuspeito;
+
+/*
+ * resolverCaminhos() – preenche uma solucao por suspeito da hash e o vetor 'pai'
+ * (indice do pai de cada sala na mansao compacta) usado para remontar os
+ * movimentos. Retorna o numero de suspeitos.
+ */
+size_t resolverCaminhos(const MansaoCompacta *mc, const HashTable *ht, size_t numIds,
+                        SolucaoSuspeito **saida, uint32_t **paiSaida) {
+    uint32_t n = mc->quantidade;
+    if (n > PILHA_INDICE) {
+        fprintf(stderr, "Erro: mansao grande demais para o solucionador\n");
+        exit(1);
+    }
+
+    /* suspeitos densos: id do pool -> 1 + posicao em 'sol' */
+    HashTable denso;
+    initHash(&denso);
+    size_t numSuspeitos = 0;
+    for (size_t i = 0; i < ht->capacidade; i++) {
+        if (!ht->slots[i].hash) continue;
+        uint32_t s = ht->slots[i].valor;
+        if (s != ID_VAZIO && encontrarSuspeito(&denso, s) == ID_VAZIO)
+            inserirNaHash(&denso, s, (uint32_t) ++numSuspeitos);
+    }
+    SolucaoSuspeito *sol = (SolucaoSuspeito*) malloc((numSuspeitos ? numSuspeitos : 1) * sizeof(SolucaoSuspeito));
+    uint32_t *contagem = (uint32_t*) calloc(numSuspeitos + 1, sizeof(uint32_t));
+    /* por sala: suspeito denso da sua pista (0 = nenhum) - pre-calculado fora da busca */
+    uint32_t *suspeitoSala = (uint32_t*) malloc((size_t) n * sizeof(uint32_t));
+    uint32_t *pai = (uint32_t*) malloc((size_t) n * sizeof(uint32_t));
+    uint64_t *noCaminho = (uint64_t*) calloc(numIds / 64 + 1, sizeof(uint64_t));
+    uint32_t *pilha = (uint32_t*) malloc(((size_t) n * 2 + 1) * sizeof(uint32_t));
+    if (!sol || !contagem || !suspeitoSala || !pai || !noCaminho || !pilha) {
+        fprintf(stderr, "Erro: falha ao alocar o solucionador\n");
+        exit(1);
+    }
+    for (size_t i = 0; i < ht->capacidade; i++) {
+        if (!ht->slots[i].hash || ht->slots[i].valor == ID_VAZIO) continue;
+        uint32_t d = encontrarSuspeito(&denso, ht->slots[i].valor);
+        sol[d - 1].suspeito = ht->slots[i].valor;
+        sol[d - 1].sala = SEM_SOLUCAO;
+        sol[d - 1].profundidade = 0;
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t s = encontrarSuspeito(ht, mc->pista[i]);
+        suspeitoSala[i] = s != ID_VAZIO ? encontrarSuspeito(&denso, s) : 0;
+    }
+    liberarHash(&denso);
+
+    size_t topo = 0;
+    uint32_t prof = 0;
+    size_t pendentes = numSuspeitos;
+    uint32_t limite = UINT32_MAX; /* profundidade maxima que ainda pode melhorar algo */
+    pai[0] = 0;
+    pilha[topo++] = 0;
+    while (topo > 0) {
+        uint32_t item = pilha[--topo];
+        uint32_t sala = item & PILHA_INDICE;
+        uint32_t pista = mc->pista[sala];
+        uint32_t s = suspeitoSala[sala];
+        if (item & PILHA_SAIDA) {
+            /* desfaz a contribuicao da sala ao sair dela */
+            if (item & PILHA_ADICIONOU) {
+                noCaminho[pista >> 6] &= ~(1ULL << (pista & 63));
+                if (s) contagem[s]--;
+            }
+            prof--;
+            continue;
+        }
+        uint32_t saida = sala | PILHA_SAIDA;
+        if (pista != ID_VAZIO && !(noCaminho[pista >> 6] & (1ULL << (pista & 63)))) {
+            noCaminho[pista >> 6] |= 1ULL << (pista & 63);
+            saida |= PILHA_ADICIONOU;
+            /* desempate por profundidade e depois pela ordem BFS (indice menor) */
+            if (s && ++contagem[s] >= 2) {
+                SolucaoSuspeito *r = &sol[s - 1];
+                if (r->sala == SEM_SOLUCAO) pendentes--;
+                if (r->sala == SEM_SOLUCAO || prof < r->profundidade ||
+                    (prof == r->profundidade && sala < r->sala)) {
+                    r->sala = sala;
+                    r->profundidade = prof;
+                    if (pendentes == 0) {
+                        limite = 0;
+                        for (size_t k = 0; k < numSuspeitos; k++)
+                            if (sol[k].profundidade > limite) limite = sol[k].profundidade;
+                    }
+                }
+            }
+        }
+        pilha[topo++] = saida;
+        prof++;
+        if (prof > limite) continue; /* filhos mais fundos que todas as solucoes */
+        if (mc->dir[sala] != SEM_FILHO) {
+            pai[mc->dir[sala]] = sala;
+            pilha[topo++] = mc->dir[sala];
+        }
+        if (mc->esq[sala] != SEM_FILHO) {
+            pai[mc->esq[sala]] = sala;
+            pilha[topo++] = mc->esq[sala];
+        }
+    }
+
+    free(contagem);
+    free(suspeitoSala);
+    free(noCaminho);
+    free(pilha);
+    *saida = sol;
+    *paiSaida = pai;
+    return numSuspeitos;
+}
+
+/* executarSolucionador() – mostra o menor caminho incriminador de cada suspeito */
+void executarSolucionador(const Mansao *m, const HashTable *ht, const InternPool *pool) {
+    MansaoCompacta mc;
+    compilarMansao(m, &mc);
+    double t0 = agoraSegundos();
+    SolucaoSuspeito *sol;
+    uint32_t *pai;
+    size_t n = resolverCaminhos(&mc, ht, pool->quantidade, &sol, &pai);
+    double t1 = agoraSegundos();
+    fprintf(stderr, "Solucionador: %u salas, %zu suspeitos em %.2f ms\n", mc.quantidade, n, (t1 - t0) * 1000.0);
+
+    /* exibe em ordem alfabetica de suspeito */
+    LinhaRanking *ordem = (LinhaRanking*) malloc((n ? n : 1) * sizeof(LinhaRanking));
+    if (!ordem) {
+        fprintf(stderr, "Erro: falha ao alocar o solucionador\n");
+        exit(1);
+    }
+    for (size_t i = 0; i < n; i++) {
+        ordem[i].nome = internTexto(pool, sol[i].suspeito);
+        ordem[i].pistas = (uint32_t) i;
+    }
+    qsort(ordem, n, sizeof(LinhaRanking), compararNomeRanking);
+    printf("== Menor caminho que incrimina cada suspeito ==\n");
+    for (size_t k = 0; k < n; k++) {
+        const SolucaoSuspeito *r = &sol[ordem[k].pistas];
+        if (r->sala == SEM_SOLUCAO) {
+            printf(" %s: impossivel (nenhum caminho reune duas pistas)\n", ordem[k].nome);
+            continue;
+        }
+        /* remonta os movimentos subindo pelos pais */
+        char *mov = (char*) malloc((size_t) r->profundidade + 1);
+        if (!mov) {
+            fprintf(stderr, "Erro: falha ao alocar o solucionador\n");
+            exit(1);
+        }
+        mov[r->profundidade] = '\0';
+        for (uint32_t sala = r->sala, i = r->profundidade; i > 0; sala = pai[sala])
+            mov[--i] = (mc.esq[pai[sala]] == sala) ? 'e' : 'd';
+        printf(" %s: %u movimento(s) \"%s\" ate %s\n", ordem[k].nome, r->profundidade,
+               r->profundidade ? mov : "(raiz)", internTexto(pool, mc.nome[r->sala]));
+        free(mov);
+    }
+    free(ordem);
+    free(sol);
+    free(pai);
+    liberarMansaoCompacta(&mc);
+}
+
+/* ===========================
+   INDICE DE BUSCA DE PISTAS (palavras e prefixos)
+   =========================== */
+
+/*
+ * Indice invertido montado uma vez apos a carga: cada palavra (em minusculas)
+ * das pistas vira um id num pool proprio; o vocabulario fica em ordem
+ * alfabetica, entao as palavras com um prefixo formam um intervalo achado por
+ * busca binaria, e cada palavra aponta para a lista ordenada das pistas que a
+ * contem. Um segundo indice liga cada pista as salas onde ela aparece.
+ */
+
+static int ehLetraPalavra(unsigned char c) {
+    return isalnum(c) || c >= 128; /* bytes UTF-8 contam como letra */
+}
+
+/* proxima palavra de 's' a partir de '*pos', em minusculas em 'buf'; retorna o tamanho (0 = fim) */
+static size_t proximaPalavra(const char *s, size_t *pos, char *buf, size_t cap) {
+    size_t i = *pos;
+    while (s[i] && !ehLetraPalavra((unsigned char) s[i])) i++;
+    size_t n = 0;
+    while (s[i] && ehLetraPalavra((unsigned char) s[i])) {
+        if (n < cap - 1) buf[n++] = (char) tolower((unsigned char) s[i]);
+        i++;
+    }
+    *pos = i;
+    return n;
+}
+
+/* palavra do vocabulario durante a ordenacao; 'chave' traz os 8 primeiros bytes
+   (big-endian, completados com zero) para resolver a maioria das comparacoes sem
+   visitar o texto */
+typedef struct {
+    uint64_t chave;
+    const char *texto;
+    uint32_t id;
+} PalavraOrdem;
+
+static int compararPalavras(const void *a, const void *b) {
+    const PalavraOrdem *x = (const PalavraOrdem*) a;
+    const PalavraOrdem *y = (const PalavraOrdem*) b;
+    if (x->chave != y->chave) return x->chave < y->chave ? -1 : 1;
+    /* chaves iguais: ou as duas palavras acabam nos 8 primeiros bytes, ou nenhuma acaba */
+    if ((x->chave & 0xFF) == 0) return 0;
+    return strcmp(x->texto + 8, y->texto + 8);
+}
+
+static uint32_t* alocarIds(size_t n) {
+    uint32_t *v = (uint32_t*) calloc(n ? n : 1, sizeof(uint32_t));
+    if (!v) {
+        fprintf(stderr, "Erro: falha ao alocar indice de busca\n");
+        exit(1);
+    }
+    return v;
+}
+
+/* par (palavra, pista) gerado na tokenizacao */
+typedef struct {
+    uint32_t palavra;
+    uint32_t pista;
+} Ocorrencia;
+
+/*
+ * construirIndiceBusca() – indexa todas as pistas conhecidas (das salas e da hash)
+ * e as salas de cada pista.
+ */
+void construirIndiceBusca(IndiceBusca *ib, const Mansao *m, const HashTable *ht, const InternPool *pool) {
+    size_t nIds = pool->quantidade;
+    unsigned char *ehPista = (unsigned char*) calloc(nIds, 1);
+    if (!ehPista) {
+        fprintf(stderr, "Erro: falha ao alocar indice de busca\n");
+        exit(1);
+    }
+    for (size_t i = 0; i < m->quantidade; i++) ehPista[m->salas[i].pista] = 1;
+    for (size_t i = 0; i < ht->capacidade; i++)
+        if (ht->slots[i].hash) ehPista[ht->slots[i].chave] = 1;
+    ehPista[ID_VAZIO] = 0;
+
+    /* tokenizacao em ordem crescente de id de pista (listas ja saem ordenadas) */
+    internIniciar(&ib->palavras);
+    size_t nOc = 0, capOc = 1024;
+    Ocorrencia *oc = (Ocorrencia*) malloc(capOc * sizeof(Ocorrencia));
+    uint32_t *ultimaPista = NULL; /* palavra -> ultima pista em que apareceu */
+    size_t capUltima = 0;
+    if (!oc) {
+        fprintf(stderr, "Erro: falha ao alocar indice de busca\n");
+        exit(1);
+    }
+    ib->numPistas = 0;
+    for (uint32_t p = 1; p < nIds; p++) {
+        if (!ehPista[p]) continue;
+        ib->numPistas++;
+        const char *texto = internTexto(pool, p);
+        char buf[MAX_PISTA];
+        size_t pos = 0, len;
+        while ((len = proximaPalavra(texto, &pos, buf, sizeof(buf))) > 0) {
+            uint32_t w = internar(&ib->palavras, buf, len);
+            if (w >= capUltima) {
+                size_t cap = capUltima ? capUltima * 2 : 1024;
+                while (cap <= w) cap *= 2;
+                uint32_t *novo = (uint32_t*) realloc(ultimaPista, cap * sizeof(uint32_t));
+                if (!novo) {
+                    fprintf(stderr, "Erro: falha ao alocar indice de busca\n");
+                    exit(1);
+                }
+                memset(novo + capUltima, 0, (cap - capUltima) * sizeof(uint32_t));
+                ultimaPista = novo;
+                capUltima = cap;
+            }
+            if (ultimaPista[w] == p) continue; /* palavra repetida na mesma pista */
+            ultimaPista[w] = p;
+            if (nOc == capOc) {
+                capOc *= 2;
+                Ocorrencia *novo = (Ocorrencia*) realloc(oc, capOc * sizeof(Ocorrencia));
+                if (!novo) {
+                    fprintf(stderr, "Erro: falha ao alocar indice de busca\n");
+                    exit(1);
+                }
+                oc = novo;
+            }
+            oc[nOc].palavra = w;
+            oc[nOc].pista = p;
+            nOc++;
+        }
+    }
+    free(ultimaPista);
+
+    /* vocabulario em ordem alfabetica; 'posicao' leva o id da palavra ao seu lugar */
+    uint32_t nVocab = ib->palavras.quantidade - 1; /* sem a string vazia */
+    PalavraOrdem *ordem = (PalavraOrdem*) malloc((nVocab ? nVocab : 1) * sizeof(PalavraOrdem));
+    uint32_t *posicao = alocarIds(ib->palavras.quantidade);
+    if (!ordem) {
+        fprintf(stderr, "Erro: falha ao alocar indice de busca\n");
+        exit(1);
+    }
+    for (uint32_t i = 0; i < nVocab; i++) {
+        ordem[i].id = i + 1;
+        ordem[i].texto = internTexto(&ib->palavras, i + 1);
+        uint64_t chave = 0;
+        int k = 0;
+        for (; k < 8 && ordem[i].texto[k]; k++) chave = (chave << 8) | (unsigned char) ordem[i].texto[k];
+        ordem[i].chave = chave << (8 * (8 - k));
+    }
+    qsort(ordem, nVocab, sizeof(PalavraOrdem), compararPalavras);
+    ib->numVocab = nVocab;
+    ib->vocab = alocarIds(nVocab);
+    for (uint32_t i = 0; i < nVocab; i++) {
+        ib->vocab[i] = ordem[i].id;
+        posicao[ordem[i].id] = i;
+    }
+    free(ordem);
+
+    /* ordenacao por contagem das ocorrencias pela posicao da palavra (estavel) */
+    ib->vocabInicio = alocarIds((size_t) nVocab + 1);
+    ib->ocorrencias = alocarIds(nOc);
+    for (size_t i = 0; i < nOc; i++) ib->vocabInicio[posicao[oc[i].palavra] + 1]++;
+    for (uint32_t i = 0; i < nVocab; i++) ib->vocabInicio[i + 1] += ib->vocabInicio[i];
+    for (size_t i = 0; i < nOc; i++) {
+        uint32_t v = posicao[oc[i].palavra];
+        ib->ocorrencias[ib->vocabInicio[v]++] = oc[i].pista;
+    }
+    /* os inicios andaram ate o fim de cada grupo: desloca de volta */
+    for (uint32_t i = nVocab; i > 0; i--) ib->vocabInicio[i] = ib->vocabInicio[i - 1];
+    ib->vocabInicio[0] = 0;
+    ib->numOcorrencias = nOc;
+    free(posicao);
+    free(oc);
+
+    /* salas de cada pista (CSR indexado pelo id da pista) */
+    ib->salasInicio = alocarIds(nIds + 1);
+    for (size_t i = 0; i < m->quantidade; i++)
+        if (m->salas[i].pista != ID_VAZIO) ib->salasInicio[m->salas[i].pista + 1]++;
+    for (size_t i = 0; i < nIds; i++) ib->salasInicio[i + 1] += ib->salasInicio[i];
+    ib->salas = alocarIds(ib->salasInicio[nIds]);
+    for (size_t i = 0; i < m->quantidade; i++) {
+        uint32_t p = m->salas[i].pista;
+        if (p != ID_VAZIO) ib->salas[ib->salasInicio[p]++] = (uint32_t) i;
+    }
+    for (size_t i = nIds; i > 0; i--) ib->salasInicio[i] = ib->salasInicio[i - 1];
+    ib->salasInicio[0] = 0;
+    free(ehPista);
+}
+
+void liberarIndiceBusca(IndiceBusca *ib) {
+    internLiberar(&ib->palavras);
+    free(ib->vocab);
+    free(ib->vocabInicio);
+    free(ib->ocorrencias);
+    free(ib->salasInicio);
+    free(ib->salas);
+}
+
+static int compararIds(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t*) a, y = *(const uint32_t*) b;
+    return (x > y) - (x < y);
+}
+
+/* pistas (ordenadas, sem repeticao) com alguma palavra comecando por 'prefixo' */
+static size_t buscarPrefixo(const IndiceBusca *ib, const char *prefixo, size_t len, uint32_t **saida) {
+    /* primeira palavra >= prefixo */
+    uint32_t lo = 0, hi = ib->numVocab;
+    while (lo < hi) {
+        uint32_t meio = lo + (hi - lo) / 2;
+        if (strncmp(internTexto(&ib->palavras, ib->vocab[meio]), prefixo, len) < 0) lo = meio + 1;
+        else hi = meio;
+    }
+    uint32_t fim = lo;
+    while (fim < ib->numVocab && strncmp(internTexto(&ib->palavras, ib->vocab[fim]), prefixo, len) == 0) fim++;
+    size_t total = ib->vocabInicio[fim] - ib->vocabInicio[lo];
+    uint32_t *r = alocarIds(total);
+    memcpy(r, ib->ocorrencias + ib->vocabInicio[lo], total * sizeof(uint32_t));
+    if (fim - lo > 1) { /* varias palavras: junta as listas */
+        qsort(r, total, sizeof(uint32_t), compararIds);
+        size_t k = 0;
+        for (size_t i = 0; i < total; i++)
+            if (k == 0 || r[k - 1] != r[i]) r[k++] = r[i];
+        total = k;
+    }
+    *saida = r;
+    return total;
+}
+
+/*
+ * buscarPistas() – pistas que tem, para cada palavra da consulta, uma palavra
+ * comecando por ela (ex.: "peg jan" acha "Pegadas sujas perto da janela").
+ * Retorna a quantidade e a lista (ordenada por id) em '*saida' (liberar com free).
+ */
+size_t buscarPistas(const IndiceBusca *ib, const char *consulta, uint32_t **saida) {
+    char buf[MAX_PISTA];
+    size_t pos = 0, len, n = 0;
+    uint32_t *acc = NULL;
+    int primeira = 1;
+    while ((len = proximaPalavra(consulta, &pos, buf, sizeof(buf))) > 0) {
+        uint32_t *r;
+        size_t nr = buscarPrefixo(ib, buf, len, &r);
+        if (primeira) {
+            acc = r;
+            n = nr;
+            primeira = 0;
+            continue;
+        }
+        /* intersecao de duas listas ordenadas */
+        size_t i = 0, j = 0, k = 0;
+        while (i < n && j < nr) {
+            if (acc[i] < r[j]) i++;
+            else if (acc[i] > r[j]) j++;
+            else { acc[k++] = acc[i]; i++; j++; }
+        }
+        n = k;
+        free(r);
+    }
+    *saida = acc ? acc : alocarIds(0);
+    return n;
+}
+
+/* executarBusca() – mostra as pistas encontradas com seus suspeitos e salas */
+void executarBusca(const IndiceBusca *ib, const InternPool *pool, const HashTable *ht,
+                   const Mansao *m, const char *consulta) {
+    const size_t maxSalas = 5;
+    uint32_t *r;
+    double t0 = agoraSegundos();
+    size_t n = buscarPistas(ib, consulta, &r);
+    double t1 = agoraSegundos();
+    printf("Busca '%s': %zu pista(s) em %.1f us\n", consulta, n, (t1 - t0) * 1e6);
+    for (size_t i = 0; i < n; i++) {
+        uint32_t suspeito = encontrarSuspeito(ht, r[i]);
+        printf(" - %s -> %s\n", internTexto(pool, r[i]),
+               suspeito != ID_VAZIO ? internTexto(pool, suspeito) : "(sem suspeito)");
+        uint32_t ini = ib->salasInicio[r[i]], fim = ib->salasInicio[r[i] + 1];
+        if (ini == fim) continue;
+        printf("     salas:");
+        for (uint32_t k = ini; k < fim && k - ini < maxSalas; k++)
+            printf("%s %s", k > ini ? "," : "", internTexto(pool, m->salas[ib->salas[k]].nome));
+        if (fim - ini > maxSalas) printf(" (+%u)", fim - ini - (uint32_t) maxSalas);
+        printf("\n");
+    }
+    free(r);
+}
+
+/* ===========================
+   AVALIACAO EM LOTE (sessoes gravadas)
+   =========================== */
+
+/*
+ * Arquivo de sessoes, uma por linha:  <acusado>|<pista>;<pista>;...
+ * Linhas vazias ou iniciadas por '#' sao ignoradas.
+ * Saida, uma linha por sessao:        <linha>;<acusado>;<qtd>;SUSTENTADA|FRAGIL
+ *
+ * Depois da carga, pool e hash ficam congelados: as threads so os leem, sem
+ * travas. Cada thread avalia um intervalo continuo de sessoes com rascunho
+ * proprio (marca por epoca de cada pista ja vista na sessao, para ignorar
+ * repeticoes como a arvore do jogo faz) e escreve os veredictos num buffer
+ * proprio; no fim os buffers sao gravados em ordem.
+ */
+
+/* sessao localizada no arquivo mapeado */
+typedef struct {
+    size_t inicio;
+    size_t fim;      /* sem o '\n' (nem '\r') */
+    size_t linha;
+} SessaoLote;
+
+/* buffer de saida de uma thread */
+typedef struct {
+    char *dados;
+    size_t tam;
+    size_t cap;
+} BufferSaida;
+
+typedef struct {
+    const HashTable *ht;          /* pista -> suspeito (somente leitura) */
+    const InternPool *pool;       /* somente leitura */
+    const unsigned char *dados;
+    const SessaoLote *sessoes;
+    size_t inicio, fim;           /* intervalo [inicio, fim) desta thread */
+    uint32_t *marca;              /* id da pista -> epoca em que foi vista */
+    uint32_t epoca;
+    size_t sustentadas;
+    BufferSaida saida;
+} TrabalhoLote;
+
+static void bufferReservar(BufferSaida *b, size_t extra) {
+    if (b->tam + extra <= b->cap) return;
+    size_t cap = b->cap ? b->cap * 2 : 4096;
+    while (cap < b->tam + extra) cap *= 2;
+    char *novo = (char*) realloc(b->dados, cap);
+    if (!novo) {
+        fprintf(stderr, "Erro: falha ao alocar buffer de saida\n");
+        exit(1);
+    }
+    b->dados = novo;
+    b->cap = cap;
+}
+
+/*
+ * avaliarSessao() – conta as pistas distintas da sessao que apontam para o
+ * acusado (mesmo resultado de verificarSuspeitoFinal apos explorar essas salas).
+ */
+static int avaliarSessao(TrabalhoLote *t, const SessaoLote *s, const char **acusado, size_t *lenAcusado) {
+    const char *p = (const char*) t->dados + s->inicio;
+    const char *fim = (const char*) t->dados + s->fim;
+    const char *sep = memchr(p, '|', (size_t)(fim - p));
+    if (!sep) sep = fim;
+    *acusado = p;
+    *lenAcusado = (size_t)(sep - p);
+    uint32_t idAcusado = internBuscarTrecho(t->pool, p, *lenAcusado);
+
+    if (++t->epoca == 0) { /* epoca deu a volta: zera as marcas */
+        memset(t->marca, 0, t->pool->quantidade * sizeof(uint32_t));
+        t->epoca = 1;
+    }
+    int qtd = 0;
+    for (p = sep + 1; p < fim; ) {
+        const char *q = memchr(p, ';', (size_t)(fim - p));
+        if (!q) q = fim;
+        uint32_t pista = internBuscarTrecho(t->pool, p, (size_t)(q - p));
+        if (pista != ID_VAZIO && t->marca[pista] != t->epoca) {
+            t->marca[pista] = t->epoca;
+            if (idAcusado != ID_VAZIO && encontrarSuspeito(t->ht, pista) == idAcusado) qtd++;
+        }
+        p = q + 1;
+    }
+    return qtd;
+}
+
+static void* trabalhadorLote(void *arg) {
+    TrabalhoLote *t = (TrabalhoLote*) arg;
+    for (size_t i = t->inicio; i < t->fim; i++) {
+        const char *acusado;
+        size_t lenAcusado;
+        int qtd = avaliarSessao(t, &t->sessoes[i], &acusado, &lenAcusado);
+        if (qtd >= 2) t->sustentadas++;
+        bufferReservar(&t->saida, lenAcusado + 64);
+        char *d = t->saida.dados + t->saida.tam;
+        int n = snprintf(d, 32, "%zu;", t->sessoes[i].linha);
+        memcpy(d + n, acusado, lenAcusado);
+        n += (int) lenAcusado;
+        n += snprintf(d + n, 32, ";%d;%s\n", qtd, qtd >= 2 ? "SUSTENTADA" : "FRAGIL");
+        t->saida.tam += (size_t) n;
+    }
+    return NULL;
+}
+
+int numeroProcessadores(void) {
+#ifdef _SC_NPROCESSORS_ONLN
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n > 0) return (int) n;
+#endif
+    return 1;
+}
+
+/*
+ * executarLote() – avalia todas as sessoes de 'caminho' contra a mansao carregada
+ * usando 'numThreads' threads e grava os veredictos em 'saida' (NULL = stdout).
+ * Reporta vazao em stderr. Retorna 1 em sucesso.
+ */
+int executarLote(const char *caminho, const char *caminhoSaida, int numThreads,
+                 const HashTable *ht, const InternPool *pool) {
+    size_t tam;
+    const unsigned char *dados = mapearArquivo(caminho, &tam);
+    if (!dados) return 0;
+
+    /* primeira passada: conta as linhas para alocar o indice de sessoes de uma vez */
+    size_t maxLinhas = 1;
+    for (const unsigned char *p = dados; (p = memchr(p, '\n', (size_t)(dados + tam - p))); p++)
+        maxLinhas++;
+    SessaoLote *sessoes = (SessaoLote*) malloc(maxLinhas * sizeof(SessaoLote));
+    if (!sessoes) {
+        fprintf(stderr, "Erro: falha ao alocar indice de sessoes\n");
+        exit(1);
+    }
+    size_t n = 0, linha = 0;
+    for (size_t pos = 0; pos < tam; ) {
+        const unsigned char *nl = memchr(dados + pos, '\n', tam - pos);
+        size_t fim = nl ? (size_t)(nl - dados) : tam;
+        size_t proximo = fim + 1;
+        linha++;
+        if (fim > pos && dados[fim - 1] == '\r') fim--;
+        if (fim > pos && dados[pos] != '#') {
+            sessoes[n].inicio = pos;
+            sessoes[n].fim = fim;
+            sessoes[n].linha = linha;
+            n++;
+        }
+        pos = proximo;
+    }
+
+    if (numThreads < 1) numThreads = 1;
+    if ((size_t) numThreads > n) numThreads = n ? (int) n : 1;
+    TrabalhoLote *trab = (TrabalhoLote*) calloc((size_t) numThreads, sizeof(TrabalhoLote));
+    pthread_t *ids = (pthread_t*) malloc((size_t) numThreads * sizeof(pthread_t));
+    if (!trab || !ids) {
+        fprintf(stderr, "Erro: falha ao alocar threads do lote\n");
+        exit(1);
+    }
+
+    double inicio = agoraSegundos();
+    for (int i = 0; i < numThreads; i++) {
+        TrabalhoLote *t = &trab[i];
+        t->ht = ht;
+        t->pool = pool;
+        t->dados = dados;
+        t->sessoes = sessoes;
+        t->inicio = n * (size_t) i / (size_t) numThreads;
+        t->fim = n * (size_t) (i + 1) / (size_t) numThreads;
+        t->marca = (uint32_t*) calloc(pool->quantidade, sizeof(uint32_t));
+        if (!t->marca) {
+            fprintf(stderr, "Erro: falha ao alocar rascunho do lote\n");
+            exit(1);
+        }
+        /* a thread 0 e a propria thread principal */
+        if (i > 0 && pthread_create(&ids[i], NULL, trabalhadorLote, t) != 0) {
+            fprintf(stderr, "Erro: falha ao criar thread do lote\n");
+            exit(1);
+        }
+    }
+    trabalhadorLote(&trab[0]);
+    for (int i = 1; i < numThreads; i++) pthread_join(ids[i], NULL);
+    double segundos = agoraSegundos() - inicio;
+
+    FILE *out = caminhoSaida ? fopen(caminhoSaida, "w") : stdout;
+    int ok = out != NULL;
+    if (!out) fprintf(stderr, "Erro: nao foi possivel criar '%s'\n", caminhoSaida);
+    size_t sustentadas = 0;
+    for (int i = 0; i < numThreads; i++) {
+        if (out) fwrite(trab[i].saida.dados, 1, trab[i].saida.tam, out);
+        sustentadas += trab[i].sustentadas;
+        free(trab[i].saida.dados);
+        free(trab[i].marca);
+    }
+    if (out && out != stdout && fclose(out) != 0) ok = 0;
+    else if (out == stdout) fflush(stdout);
+
+    fprintf(stderr, "Lote: %zu sessoes (%zu sustentadas) em %.2f ms com %d thread(s): %.0f sessoes/s\n",
+            n, sustentadas, segundos * 1000.0, numThreads, segundos > 0 ? n / segundos : 0.0);
+    free(trab);
+    free(ids);
+    free(sessoes);
+    desmapearArquivo(dados, tam);
+    return ok;
+}
+
+/*
+ * gerarSessoes() – grava 'n' sessoes sinteticas para a mansao carregada: cada
+ * uma desce da raiz por um caminho aleatorio coletando as pistas e acusa o
+ * suspeito de uma das pistas coletadas. Usado para medir o modo em lote.
+ */
+int gerarSessoes(const char *caminho, size_t n, uint64_t semente,
+                 const Mansao *m, const HashTable *ht, const InternPool *pool) {
+    FILE *f = fopen(caminho, "w");
+    if (!f) {
+        fprintf(stderr, "Erro: nao foi possivel criar '%s'\n", caminho);
+        return 0;
+    }
+    uint64_t x = semente ? semente : 0x9E3779B97F4A7C15ULL;
+    for (size_t i = 0; i < n; i++) {
+        uint32_t pistas[64];
+        int k = 0;
+        for (const Sala *s = &m->salas[0]; s && k < 64; ) {
+            if (s->pista != ID_VAZIO) pistas[k++] = s->pista;
+            if (proximoAleatorio(&x) % 8 == 0) break; /* jogador sai antes de chegar a uma folha */
+            s = (x & 16) ? s->dir : s->esq;
+        }
+        uint64_t sorteio = proximoAleatorio(&x);
+        uint32_t acusado = k ? encontrarSuspeito(ht, pistas[sorteio % (uint64_t) k]) : ID_VAZIO;
+        fputs(acusado != ID_VAZIO ? internTexto(pool, acusado) : "Ninguem", f);
+        for (int j = 0; j < k; j++) {
+            fputc(j ? ';' : '|', f);
+            fputs(internTexto(pool, pistas[j]), f);
+        }
+        fputc('\n', f);
+    }
+    int ok = !ferror(f);
+    if (fclose(f) != 0) ok = 0;
+    if (!ok) fprintf(stderr, "Erro: falha ao gravar '%s'\n", caminho);
+    return ok;
+}
+
+/* ===========================
+   BASE DE PISTAS EM DISCO
+   =========================== */
+
+/*
+ * Arquivo DQC1: o mapa pista -> suspeito fora da memoria. Depois do cabecalho
+ * vem o filtro de Bloom e, alinhado a pagina, o vetor de HashSlot na mesma
+ * disposicao Robin Hood da HashTable (so pistas que apontam para alguem).
+ * Ao abrir, so o cabecalho e o Bloom (10 bits por pista) vao para a memoria.
+ * Cada consulta passa por:
+ *   1. filtro de Bloom (pista sem suspeito e rejeitada sem tocar o disco);
+ *   2. cache LRU limitado (acertos nao tocam o disco);
+ *   3. leitura do bloco de BASE_BLOCO posicoes onde a sondagem comeca (e dos
+ *      seguintes, se ela atravessar o fim do bloco); o resultado entra no cache.
+ * Os ids sao do pool da mansao carregada, conferido pela assinatura do pool.
+ * A base e usada pelas threads do lote e do servidor: a trava protege so a
+ * lista LRU e os baldes do cache. O Bloom nao muda depois de aberto, a leitura
+ * do disco usa um buffer de quem consulta (fora da trava) e os contadores sao
+ * atomicos.
+ */
+
+#define BASE_MAGIA "DQC1"
+#define BASE_BLOCO 256              /* posicoes lidas por acesso ao disco (3 KB) */
+#define BASE_PAGINA 4096
+#define BASE_CACHE_PADRAO 65536     /* entradas no cache LRU */
+#define BLOOM_BITS_POR_PISTA 10     /* ~1% de falsos positivos com 7 hashes */
+#define BLOOM_HASHES 7
+#define LRU_NULO UINT32_MAX
+
+typedef struct {
+    char magia[4];
+    uint32_t numHashes;
+    AssinaturaPool pool;      /* ids das pistas so valem para este pool */
+    uint64_t bitsBloom;       /* potencia de dois */
+    uint64_t capacidade;      /* posicoes do vetor de HashSlot (potencia de dois) */
+    uint64_t quantidade;
+    uint64_t desBloom;
+    uint64_t desSlots;
+} CabecalhoBase;
+
+typedef struct {
+    uint32_t pista;
+    uint32_t suspeito;        /* ID_VAZIO: falso positivo do Bloom ja confirmado */
+    uint32_t ant, prox;       /* lista LRU, mais recente na cabeca */
+    uint32_t proxBalde;       /* encadeamento no indice do cache */
+} EntradaCache;
+
+struct BasePistas {
+#ifndef _WIN32
+    int fd;
+#else
+    FILE *f;
+    pthread_mutex_t travaArquivo; /* fseek + fread nao e atomico como pread */
+#endif
+    CabecalhoBase cab;
+    uint64_t *bloom;          /* so leitura depois de aberta: dispensa a trava */
+    EntradaCache *cache;
+    uint32_t *baldes;         /* hash da pista -> primeira entrada do balde */
+    uint32_t mascaraBaldes;
+    uint32_t capCache, usadas;
+    uint32_t cabeca, cauda;
+    pthread_mutex_t trava;    /* protege so o cache (indice e lista LRU) */
+    /* contadores, atualizados fora da trava */
+    _Atomic uint64_t consultas, acertosCache, rejeitadasBloom, leiturasDisco, falsosPositivos;
+    _Atomic uint64_t nanos, maximoNanos;
+};
+
+/* posicoes do Bloom por hash duplo a partir do hash da pista */
+static uint64_t bloomPasso(uint32_t h, uint64_t *inicio) {
+    *inicio = (uint64_t) h * 0x9E3779B97F4A7C15ULL;
+    return ((uint64_t) hashId(h ^ 0x5BD1E995u) << 1) | 1;
+}
+
+static void bloomAdicionar(uint64_t *bloom, uint64_t bits, uint32_t h) {
+    uint64_t pos, passo = bloomPasso(h, &pos);
+    for (int i = 0; i < BLOOM_HASHES; i++, pos += passo)
+        bloom[(pos & (bits - 1)) >> 6] |= 1ULL << (pos & 63);
+}
+
+static int bloomContem(const BasePistas *b, uint32_t h) {
+    uint64_t pos, passo = bloomPasso(h, &pos), bits = b->cab.bitsBloom;
+    for (uint32_t i = 0; i < b->cab.numHashes; i++, pos += passo)
+        if (!(b->bloom[(pos & (bits - 1)) >> 6] & (1ULL << (pos & 63)))) return 0;
+    return 1;
+}
+
+static size_t alinharBase(size_t x, size_t a) {
+    return (x + a - 1) & ~(a - 1);
+}
+
+/*
+ * salvarBasePistas() – grava o mapa pista -> suspeito de 'ht' no formato DQC1
+ * (pistas sem suspeito ficam de fora e sao respondidas pelo Bloom).
+ * Retorna 1 em sucesso.
+ */
+int salvarBasePistas(const char *caminho, const HashTable *ht, const InternPool *pool) {
+    HashTable disco;
+    initHash(&disco);
+    reservarHash(&disco, ht->quantidade);
+    for (size_t i = 0; i < ht->capacidade; i++)
+        if (ht->slots[i].hash && ht->slots[i].valor != ID_VAZIO)
+            inserirNaHash(&disco, ht->slots[i].chave, ht->slots[i].valor);
+
+    CabecalhoBase c;
+    memset(&c, 0, sizeof(c));
+    memcpy(c.magia, BASE_MAGIA, 4);
+    c.pool = pool->assinatura;
+    c.numHashes = BLOOM_HASHES;
+    c.bitsBloom = 64;
+    while (c.bitsBloom < disco.quantidade * BLOOM_BITS_POR_PISTA) c.bitsBloom *= 2;
+    c.capacidade = disco.capacidade;
+    c.quantidade = disco.quantidade;
+    c.desBloom = alinharBase(sizeof(c), 64);
+    c.desSlots = alinharBase(c.desBloom + c.bitsBloom / 8, BASE_PAGINA);
+
+    uint64_t *bloom = (uint64_t*) calloc(c.bitsBloom / 64, sizeof(uint64_t));
+    if (!bloom) {
+        fprintf(stderr, "Erro: falha ao alocar filtro de Bloom\n");
+        exit(1);
+    }
+    for (size_t i = 0; i < disco.capacidade; i++)
+        if (disco.slots[i].hash) bloomAdicionar(bloom, c.bitsBloom, disco.slots[i].hash);
+
+    FILE *f = fopen(caminho, "wb");
+    int ok = f != NULL;
+    if (f) {
+        static const unsigned char zeros[BASE_PAGINA];
+        fwrite(&c, sizeof(c), 1, f);
+        fwrite(zeros, 1, c.desBloom - sizeof(c), f);
+        fwrite(bloom, sizeof(uint64_t), c.bitsBloom / 64, f);
+        fwrite(zeros, 1, c.desSlots - (c.desBloom + c.bitsBloom / 8), f);
+        fwrite(disco.slots, sizeof(HashSlot), disco.capacidade, f);
+        ok = !ferror(f);
+        if (fclose(f) != 0) ok = 0;
+    }
+    if (!ok) fprintf(stderr, "Erro: falha ao gravar '%s'\n", caminho);
+    else fprintf(stderr, "Base de pistas: %zu pistas, %zu posicoes, Bloom de %llu bits em '%s'\n",
+                 disco.quantidade, disco.capacidade, (unsigned long long) c.bitsBloom, caminho);
+    free(bloom);
+    liberarHash(&disco);
+    return ok;
+}
+
+/* le 'n' bytes a partir de 'deslocamento'; retorna 1 se leu tudo */
+static int lerBase(BasePistas *b, uint64_t deslocamento, void *dest, size_t n) {
+#ifndef _WIN32
+    size_t lidos = 0;
+    while (lidos < n) {
+        ssize_t r = pread(b->fd, (char*) dest + lidos, n - lidos, (off_t)(deslocamento + lidos));
+        if (r <= 0) return 0;
+        lidos += (size_t) r;
+    }
+    return 1;
+#else
+    pthread_mutex_lock(&b->travaArquivo);
+    int ok = fseek(b->f, (long) deslocamento, SEEK_SET) == 0 && fread(dest, 1, n, b->f) == n;
+    pthread_mutex_unlock(&b->travaArquivo);
+    return ok;
+#endif
+}
+
+static void fecharArquivoBase(BasePistas *b) {
+#ifndef _WIN32
+    if (b->fd >= 0) close(b->fd);
+#else
+    if (b->f) fclose(b->f);
+    pthread_mutex_destroy(&b->travaArquivo);
+#endif
+}
+
+void fecharBasePistas(BasePistas *b) {
+    fecharArquivoBase(b);
+    pthread_mutex_destroy(&b->trava);
+    free(b->bloom);
+    free(b->cache);
+    free(b->baldes);
+    free(b);
+}
+
+/*
+ * abrirBasePistas() – abre a base DQC1 para o pool carregado, com cache de
+ * 'capCache' entradas. Retorna NULL (com mensagem) em erro.
+ */
+BasePistas* abrirBasePistas(const char *caminho, const InternPool *pool, size_t capCache) {
+    BasePistas *b = (BasePistas*) calloc(1, sizeof(BasePistas));
+    if (!b) {
+        fprintf(stderr, "Erro: falha ao alocar base de pistas\n");
+        exit(1);
+    }
+    uint64_t tam = 0;
+#ifndef _WIN32
+    struct stat st;
+    b->fd = open(caminho, O_RDONLY);
+    if (b->fd >= 0 && fstat(b->fd, &st) == 0) tam = (uint64_t) st.st_size;
+    int aberto = b->fd >= 0;
+#else
+    pthread_mutex_init(&b->travaArquivo, NULL);
+    b->f = fopen(caminho, "rb");
+    if (b->f && fseek(b->f, 0, SEEK_END) == 0) tam = (uint64_t) ftell(b->f);
+    int aberto = b->f != NULL;
+#endif
+    const char *erro = NULL;
+    const CabecalhoBase *c = &b->cab;
+    if (!aberto)
+        erro = "nao foi possivel abrir";
+    else if (tam < sizeof(b->cab) || !lerBase(b, 0, &b->cab, sizeof(b->cab)))
+        erro = "arquivo truncado";
+    else if (memcmp(c->magia, BASE_MAGIA, 4) != 0)
+        erro = "formato desconhecido (esperado DQC1)";
+    else if (!mesmaAssinatura(&c->pool, &pool->assinatura))
+        erro = "base de outra mansao";
+    else if (c->bitsBloom < 64 || (c->bitsBloom & (c->bitsBloom - 1)) != 0 || c->numHashes == 0 ||
+             c->capacidade == 0 || (c->capacidade & (c->capacidade - 1)) != 0 || c->quantidade > c->capacidade ||
+             c->desBloom > tam || (tam - c->desBloom) / 8 < c->bitsBloom / 64 ||
+             c->desSlots > tam || (tam - c->desSlots) / sizeof(HashSlot) < c->capacidade)
+        erro = "cabecalho invalido";
+    if (erro) {
+        fprintf(stderr, "Erro: %s: %s\n", caminho, erro);
+        fecharArquivoBase(b);
+        free(b);
+        return NULL;
+    }
+
+    if (capCache < 1) capCache = 1;
+    if (capCache > UINT32_MAX / 2) capCache = UINT32_MAX / 2;
+    b->capCache = (uint32_t) capCache;
+    uint32_t numBaldes = 1;
+    while (numBaldes < b->capCache) numBaldes *= 2;
+    b->mascaraBaldes = numBaldes - 1;
+    b->bloom = (uint64_t*) malloc(c->bitsBloom / 8);
+    b->cache = (EntradaCache*) malloc(b->capCache * sizeof(EntradaCache));
+    b->baldes = (uint32_t*) malloc(numBaldes * sizeof(uint32_t));
+    if (!b->bloom || !b->cache || !b->baldes) {
+        fprintf(stderr, "Erro: falha ao alocar base de pistas\n");
+        exit(1);
+    }
+    memset(b->baldes, 0xFF, numBaldes * sizeof(uint32_t)); /* LRU_NULO */
+    b->cabeca = b->cauda = LRU_NULO;
+    pthread_mutex_init(&b->trava, NULL);
+    if (!lerBase(b, c->desBloom, b->bloom, c->bitsBloom / 8)) {
+        fprintf(stderr, "Erro: %s: falha ao ler o filtro de Bloom\n", caminho);
+        fecharBasePistas(b);
+        return NULL;
+    }
+    return b;
+}
+
+/*
+ * procura a pista no disco; ID_VAZIO se ela nao estiver la. 'bloco' e o buffer
+ * de leitura do chamador (BASE_BLOCO posicoes), para consultas em paralelo.
+ */
+static uint32_t lerSuspeitoDisco(BasePistas *b, uint32_t pista, uint32_t h, HashSlot *bloco) {
+    uint64_t mascara = b->cab.capacidade - 1;
+    uint64_t pos = h & mascara, inicioBloco = 0, fimBloco = 0;
+    for (uint64_t dist = 0;; dist++) {
+        if (pos < inicioBloco || pos >= fimBloco) {
+            inicioBloco = pos & ~(uint64_t)(BASE_BLOCO - 1);
+            fimBloco = inicioBloco + BASE_BLOCO;
+            if (fimBloco > b->cab.capacidade) fimBloco = b->cab.capacidade;
+            atomic_fetch_add_explicit(&b->leiturasDisco, 1, memory_order_relaxed);
+            if (!lerBase(b, b->cab.desSlots + inicioBloco * sizeof(HashSlot), bloco,
+                         (size_t)(fimBloco - inicioBloco) * sizeof(HashSlot))) {
+                fprintf(stderr, "Erro: falha ao ler a base de pistas\n");
+                exit(1);
+            }
+        }
+        const HashSlot *slot = &bloco[pos - inicioBloco];
+        /* mesma regra de buscarSlot(): posicao livre ou residente mais perto de casa encerra */
+        if (slot->hash == 0 || ((pos - (slot->hash & mascara)) & mascara) < dist) return ID_VAZIO;
+        if (slot->hash == h && slot->chave == pista) return slot->valor;
+        pos = (pos + 1) & mascara;
+    }
+}
+
+static void lruDesligar(BasePistas *b, uint32_t e) {
+    EntradaCache *x = &b->cache[e];
+    if (x->ant != LRU_NULO) b->cache[x->ant].prox = x->prox;
+    else b->cabeca = x->prox;
+    if (x->prox != LRU_NULO) b->cache[x->prox].ant = x->ant;
+    else b->cauda = x->ant;
+}
+
+static void lruNaCabeca(BasePistas *b, uint32_t e) {
+    b->cache[e].ant = LRU_NULO;
+    b->cache[e].prox = b->cabeca;
+    if (b->cabeca != LRU_NULO) b->cache[b->cabeca].ant = e;
+    b->cabeca = e;
+    if (b->cauda == LRU_NULO) b->cauda = e;
+}
+
+/* entrada da pista no cache (LRU_NULO se ausente); chamar com a trava */
+static uint32_t cacheBuscar(const BasePistas *b, uint32_t pista, uint32_t h) {
+    uint32_t e = b->baldes[h & b->mascaraBaldes];
+    while (e != LRU_NULO && b->cache[e].pista != pista) e = b->cache[e].proxBalde;
+    return e;
+}
+
+/* guarda a resposta no cache, descartando a entrada usada ha mais tempo se estiver cheio */
+static void cacheGuardar(BasePistas *b, uint32_t pista, uint32_t h, uint32_t suspeito) {
+    uint32_t e;
+    if (cacheBuscar(b, pista, h) != LRU_NULO) return; /* outra thread leu a mesma pista antes */
+    if (b->usadas < b->capCache) {
+        e = b->usadas++;
+    } else {
+        e = b->cauda;
+        lruDesligar(b, e);
+        uint32_t *p = &b->baldes[hashId(b->cache[e].pista) & b->mascaraBaldes];
+        while (*p != e) p = &b->cache[*p].proxBalde;
+        *p = b->cache[e].proxBalde;
+    }
+    b->cache[e].pista = pista;
+    b->cache[e].suspeito = suspeito;
+    b->cache[e].proxBalde = b->baldes[h & b->mascaraBaldes];
+    b->baldes[h & b->mascaraBaldes] = e;
+    lruNaCabeca(b, e);
+}
+
+/*
+ * consultarBasePistas() – suspeito da pista (ID_VAZIO se nenhum) pela ordem
+ * Bloom -> cache -> disco, atualizando os contadores. So o cache fica sob a
+ * trava: o Bloom nao muda depois de aberto e a leitura do disco usa um buffer
+ * local, entao consultas de threads diferentes so se encontram na lista LRU.
+ */
+uint32_t consultarBasePistas(BasePistas *b, uint32_t pista) {
+    double t0 = agoraSegundos();
+    uint32_t h = hashId(pista), suspeito = ID_VAZIO;
+    atomic_fetch_add_explicit(&b->consultas, 1, memory_order_relaxed);
+    if (!bloomContem(b, h)) {
+        /* o cache so guarda pistas aceitas pelo Bloom: consultar antes nao muda nada */
+        atomic_fetch_add_explicit(&b->rejeitadasBloom, 1, memory_order_relaxed);
+    } else {
+        pthread_mutex_lock(&b->trava);
+        uint32_t e = cacheBuscar(b, pista, h);
+        if (e != LRU_NULO) {
+            suspeito = b->cache[e].suspeito;
+            if (b->cabeca != e) {
+                lruDesligar(b, e);
+                lruNaCabeca(b, e);
+            }
+        }
+        pthread_mutex_unlock(&b->trava);
+        if (e != LRU_NULO) {
+            atomic_fetch_add_explicit(&b->acertosCache, 1, memory_order_relaxed);
+        } else {
+            HashSlot bloco[BASE_BLOCO];
+            suspeito = lerSuspeitoDisco(b, pista, h, bloco);
+            if (suspeito == ID_VAZIO) atomic_fetch_add_explicit(&b->falsosPositivos, 1, memory_order_relaxed);
+            pthread_mutex_lock(&b->trava);
+            cacheGuardar(b, pista, h, suspeito);
+            pthread_mutex_unlock(&b->trava);
+        }
+    }
+    uint64_t ns = (uint64_t)((agoraSegundos() - t0) * 1e9);
+    atomic_fetch_add_explicit(&b->nanos, ns, memory_order_relaxed);
+    uint64_t max = atomic_load_explicit(&b->maximoNanos, memory_order_relaxed);
+    while (ns > max && !atomic_compare_exchange_weak_explicit(&b->maximoNanos, &max, ns,
+                                                              memory_order_relaxed, memory_order_relaxed)) {
+    }
+    return suspeito;
+}
+
+/* contadores da base em stderr (junto com os relatorios de memoria) */
+void relatarBasePistas(const BasePistas *b) {
+    uint64_t consultas = atomic_load(&b->consultas);
+    double n = consultas ? (double) consultas : 1.0;
+    /* rejeitadas pelo Bloom nunca chegam ao cache: a taxa e sobre as que chegam */
+    uint64_t rejeitadas = atomic_load(&b->rejeitadasBloom);
+    uint64_t noCache = consultas > rejeitadas ? consultas - rejeitadas : 0;
+    fprintf(stderr, "Base de pistas: %llu consultas, cache %.1f%% das aceitas pelo Bloom (%llu acertos, %u/%u entradas), "
+                    "Bloom rejeitou %llu, %llu leituras de disco (%llu falsos positivos), "
+                    "latencia media %.2f us, max %.2f us\n",
+            (unsigned long long) consultas,
+            100.0 * (double) atomic_load(&b->acertosCache) / (noCache ? (double) noCache : 1.0),
+            (unsigned long long) atomic_load(&b->acertosCache), b->usadas, b->capCache,
+            (unsigned long long) rejeitadas, (unsigned long long) atomic_load(&b->leiturasDisco),
+            (unsigned long long) atomic_load(&b->falsosPositivos), (double) atomic_load(&b->nanos) / n / 1e3,
+            (double) atomic_load(&b->maximoNanos) / 1e3);
+}
+
+/* ===========================
+   MULTIJOGADOR (mapa de pistas versionado)
+   =========================== */
+
+/*
+ * Varios jogadores (threads) exploram a mesma mansao ao mesmo tempo, cada um
+ * com sua propria Investigacao. A mansao e o pool ficam congelados apos a
+ * carga; o mapa pista -> suspeito pode ser alterado pelo mestre do jogo.
+ *
+ * Cada alteracao copia a versao atual, modifica a copia e a publica trocando
+ * um ponteiro atomico. Leitores nunca travam: anunciam a epoca global no seu
+ * slot, leem o ponteiro atual, consultam e zeram o slot (passos de tamanho
+ * fixo). A versao substituida vai para a lista de aposentadas com a epoca em
+ * que saiu; ela so e liberada quando todo leitor ativo anunciou uma epoca
+ * posterior, ou seja, ninguem mais pode estar com o ponteiro antigo.
+ */
+
+typedef struct VersaoMapa {
+    HashTable ht;                 /* pista -> suspeito; imutavel depois de publicada */
+    uint64_t numero;
+    uint64_t aposentadaEm;        /* epoca global em que deixou de ser a atual */
+    struct VersaoMapa *proxima;   /* lista de aposentadas */
+} VersaoMapa;
+
+/* slot de anuncio de um leitor, um por linha de cache para evitar falso compartilhamento */
+typedef struct {
+    _Alignas(64) _Atomic uint64_t epoca; /* 0 = fora de leitura */
+} LeitorEpoca;
+
+typedef struct {
+    _Atomic(VersaoMapa*) atual;
+    _Atomic uint64_t epoca;       /* epoca global, comeca em 1 */
+    LeitorEpoca *leitores;
+    int numLeitores;
+    pthread_mutex_t escrita;      /* serializa os escritores; leitores nunca o usam */
+    VersaoMapa *aposentadas;
+    size_t publicadas, liberadas;
+} MapaCompartilhado;
+
+static VersaoMapa* novaVersaoMapa(const HashTable *orig, uint64_t numero) {
+    VersaoMapa *v = (VersaoMapa*) malloc(sizeof(VersaoMapa));
+    if (!v) {
+        fprintf(stderr, "Erro: falha ao alocar versao do mapa\n");
+        exit(1);
+    }
+    copiarHash(&v->ht, orig);
+    v->numero = numero;
+    v->aposentadaEm = 0;
+    v->proxima = NULL;
+    return v;
+}
 
-#define MAX_NOME 64
-#define MAX_PISTA 128
-#define HASH_TABLE_SIZE 101
+/* iniciarMapaCompartilhado() – publica uma copia de 'base' como versao 1 */
+void iniciarMapaCompartilhado(MapaCompartilhado *mc, const HashTable *base, int numLeitores) {
+    mc->leitores = (LeitorEpoca*) aligned_alloc(_Alignof(LeitorEpoca), (size_t) numLeitores * sizeof(LeitorEpoca));
+    if (!mc->leitores) {
+        fprintf(stderr, "Erro: falha ao alocar leitores do mapa\n");
+        exit(1);
+    }
+    for (int i = 0; i < numLeitores; i++) atomic_init(&mc->leitores[i].epoca, 0);
+    mc->numLeitores = numLeitores;
+    atomic_init(&mc->epoca, 1);
+    atomic_init(&mc->atual, novaVersaoMapa(base, 1));
+    pthread_mutex_init(&mc->escrita, NULL);
+    mc->aposentadas = NULL;
+    mc->publicadas = 1;
+    mc->liberadas = 0;
+}
 
-/* ===========================
-   ESTRUTURAS
-   =========================== */
+/*
+ * entrarLeitura() – anuncia o leitor e devolve a versao atual do mapa, valida
+ * ate sairLeitura(). Sem travas nem lacos de repeticao.
+ */
+const HashTable* entrarLeitura(MapaCompartilhado *mc, int leitor) {
+    atomic_store(&mc->leitores[leitor].epoca, atomic_load(&mc->epoca));
+    return &atomic_load(&mc->atual)->ht;
+}
 
-/* Nó da árvore da mansão (cada sala) */
-typedef struct Sala {
-    char nome[MAX_NOME];
-    char pista[MAX_PISTA]; /* pista associada a essa sala (pode estar vazia) */
-    struct Sala *esq;
-    struct Sala *dir;
-} Sala;
+void sairLeitura(MapaCompartilhado *mc, int leitor) {
+    atomic_store_explicit(&mc->leitores[leitor].epoca, 0, memory_order_release);
+}
 
-/* Nó da BST que armazena pistas coletadas (ordenação por string) */
-typedef struct PistaNode {
-    char pista[MAX_PISTA];
-    struct PistaNode *esq;
-    struct PistaNode *dir;
-} PistaNode;
+/* libera as aposentadas que nenhum leitor ativo pode enxergar (chamar com 'escrita' travado) */
+static void recolherVersoes(MapaCompartilhado *mc) {
+    uint64_t minimo = UINT64_MAX;
+    for (int i = 0; i < mc->numLeitores; i++) {
+        uint64_t e = atomic_load(&mc->leitores[i].epoca);
+        if (e != 0 && e < minimo) minimo = e;
+    }
+    VersaoMapa **p = &mc->aposentadas;
+    while (*p) {
+        VersaoMapa *v = *p;
+        if (v->aposentadaEm < minimo) { /* leitores que a viram anunciaram epoca <= aposentadaEm */
+            *p = v->proxima;
+            liberarHash(&v->ht);
+            free(v);
+            mc->liberadas++;
+        } else {
+            p = &v->proxima;
+        }
+    }
+}
+
+/*
+ * reatribuirPista() – mestre do jogo: publica uma nova versao do mapa em que
+ * 'pista' aponta para 'suspeito' (mesma regra de inserirNaHash). Escritores
+ * sao serializados entre si; os leitores continuam na versao que ja pegaram.
+ */
+void reatribuirPista(MapaCompartilhado *mc, uint32_t pista, uint32_t suspeito) {
+    pthread_mutex_lock(&mc->escrita);
+    VersaoMapa *antiga = atomic_load(&mc->atual);
+    VersaoMapa *nova = novaVersaoMapa(&antiga->ht, antiga->numero + 1);
+    inserirNaHash(&nova->ht, pista, suspeito);
+    atomic_store(&mc->atual, nova);
+    antiga->aposentadaEm = atomic_fetch_add(&mc->epoca, 1);
+    antiga->proxima = mc->aposentadas;
+    mc->aposentadas = antiga;
+    mc->publicadas++;
+    recolherVersoes(mc);
+    pthread_mutex_unlock(&mc->escrita);
+}
 
-/* Entrada da tabela hash: chave = pista, valor = nome do suspeito */
-typedef struct HashEntry {
-    char pista[MAX_PISTA];
-    char suspeito[MAX_NOME];
-    struct HashEntry *prox;
-} HashEntry;
+/* libera todas as versoes; so pode ser chamada sem leitores ativos */
+void liberarMapaCompartilhado(MapaCompartilhado *mc) {
+    VersaoMapa *atual = atomic_load(&mc->atual);
+    atual->aposentadaEm = 0;
+    atual->proxima = mc->aposentadas;
+    mc->aposentadas = atual;
+    recolherVersoes(mc);
+    pthread_mutex_destroy(&mc->escrita);
+    free(mc->leitores);
+}
 
-/* A tabela hash é um vetor de ponteiros para HashEntry (lista encadeada por bucket) */
+/* jogador simulado: desce da raiz por caminhos aleatorios e acusa o mais citado */
 typedef struct {
-    HashEntry *buckets[HASH_TABLE_SIZE];
-} HashTable;
+    MapaCompartilhado *mapa;
+    const Mansao *m;
+    const InternPool *pool;
+    int leitor;
+    size_t rodadas;
+    uint64_t semente;
+    size_t consultas, sustentadas;
+    _Atomic int *jogando;         /* jogadores que ainda nao terminaram */
+} Jogador;
 
-/* ===========================
-   FUNCOES DE SALA (MANSÃO)
-   =========================== */
+static void* threadJogador(void *arg) {
+    Jogador *j = (Jogador*) arg;
+    Investigacao inv;
+    iniciarInvestigacao(&inv);
+    uint64_t x = j->semente;
+    for (size_t r = 0; r < j->rodadas; r++) {
+        reiniciarInvestigacao(&inv);
+        for (const Sala *s = &j->m->salas[0]; s; ) {
+            if (s->pista != ID_VAZIO) {
+                const HashTable *ht = entrarLeitura(j->mapa, j->leitor);
+                registrarPista(&inv, j->pool, ht, s->pista);
+                sairLeitura(j->mapa, j->leitor);
+                j->consultas++;
+            }
+            if (proximoAleatorio(&x) % 8 == 0) break; /* jogador sai antes de chegar a uma folha */
+            s = (x & 16) ? s->dir : s->esq;
+        }
+        /* acusa o suspeito com mais pistas nesta rodada */
+        uint32_t maisCitado = ID_VAZIO, maximo = 0;
+        for (size_t i = 0; i < inv.contagem.capacidade; i++) {
+            const HashSlot *slot = &inv.contagem.slots[i];
+            if (slot->hash && slot->valor > maximo) {
+                maximo = slot->valor;
+                maisCitado = slot->chave;
+            }
+        }
+        if (verificarSuspeitoFinal(&inv, maisCitado) >= 2) j->sustentadas++;
+    }
+    liberarInvestigacao(&inv);
+    atomic_fetch_sub(j->jogando, 1);
+    return NULL;
+}
+
+/* mestre do jogo: reatribui pistas a suspeitos existentes enquanto houver jogadores */
+typedef struct {
+    MapaCompartilhado *mapa;
+    const uint32_t *pistas, *suspeitos;
+    size_t numPistas, numSuspeitos;
+    uint64_t semente;
+    _Atomic int *jogando;
+} MestreJogo;
+
+static void* threadMestre(void *arg) {
+    MestreJogo *mj = (MestreJogo*) arg;
+    uint64_t x = mj->semente;
+    struct timespec pausa = { 0, 1000000 }; /* 1 ms entre alteracoes */
+    while (atomic_load(mj->jogando) > 0) {
+        uint32_t pista = mj->pistas[proximoAleatorio(&x) % mj->numPistas];
+        reatribuirPista(mj->mapa, pista, mj->suspeitos[proximoAleatorio(&x) % mj->numSuspeitos]);
+        nanosleep(&pausa, NULL);
+    }
+    return NULL;
+}
 
 /*
- * criarSala() – cria dinamicamente um cômodo com nome e pista (pista pode ser "")
- * retorna: ponteiro para a Sala alocada
+ * executarMultijogador() – 'numJogadores' threads jogam 'rodadas' partidas cada
+ * na mesma mansao enquanto um mestre do jogo reatribui pistas entre os suspeitos
+ * ja existentes. Reporta vazao e versoes publicadas/liberadas em stderr.
  */
-Sala* criarSala(const char *nome, const char *pista) {
-    Sala *s = (Sala*) malloc(sizeof(Sala));
-    if (!s) {
-        fprintf(stderr, "Erro: falha na alocacao de sala\n");
+void executarMultijogador(const Mansao *m, const HashTable *ht, const InternPool *pool,
+                          int numJogadores, size_t rodadas) {
+    if (numJogadores < 1) numJogadores = 1;
+
+    /* pistas e suspeitos existentes: o mestre so troca associacoes entre eles */
+    uint32_t *pistas = (uint32_t*) malloc((ht->quantidade + 1) * sizeof(uint32_t));
+    uint32_t *suspeitos = (uint32_t*) malloc((ht->quantidade + 1) * sizeof(uint32_t));
+    unsigned char *visto = (unsigned char*) calloc(pool->quantidade, 1);
+    Jogador *jogadores = (Jogador*) calloc((size_t) numJogadores, sizeof(Jogador));
+    pthread_t *ids = (pthread_t*) malloc((size_t) numJogadores * sizeof(pthread_t));
+    if (!pistas || !suspeitos || !visto || !jogadores || !ids) {
+        fprintf(stderr, "Erro: falha ao alocar multijogador\n");
         exit(1);
     }
-    strncpy(s->nome, nome, MAX_NOME - 1);
-    s->nome[MAX_NOME - 1] = '\0';
-    if (pista && pista[0] != '\0')
-        strncpy(s->pista, pista, MAX_PISTA - 1);
-    else
-        s->pista[0] = '\0';
-    s->pista[MAX_PISTA - 1] = '\0';
-    s->esq = s->dir = NULL;
-    return s;
-}
+    size_t numPistas = 0, numSuspeitos = 0;
+    for (size_t i = 0; i < ht->capacidade; i++) {
+        const HashSlot *slot = &ht->slots[i];
+        if (!slot->hash || slot->valor == ID_VAZIO) continue;
+        pistas[numPistas++] = slot->chave;
+        if (!visto[slot->valor]) {
+            visto[slot->valor] = 1;
+            suspeitos[numSuspeitos++] = slot->valor;
+        }
+    }
+    free(visto);
+
+    MapaCompartilhado mapa;
+    iniciarMapaCompartilhado(&mapa, ht, numJogadores);
+    _Atomic int jogando;
+    atomic_init(&jogando, numJogadores);
+
+    double inicio = agoraSegundos();
+    for (int i = 0; i < numJogadores; i++) {
+        Jogador *j = &jogadores[i];
+        j->mapa = &mapa;
+        j->m = m;
+        j->pool = pool;
+        j->leitor = i;
+        j->rodadas = rodadas;
+        j->semente = 0x9E3779B97F4A7C15ULL * (uint64_t)(i + 1);
+        j->jogando = &jogando;
+        if (pthread_create(&ids[i], NULL, threadJogador, j) != 0) {
+            fprintf(stderr, "Erro: falha ao criar thread de jogador\n");
+            exit(1);
+        }
+    }
+    /* a thread principal faz o papel do mestre do jogo */
+    if (numPistas > 0) {
+        MestreJogo mestre = { &mapa, pistas, suspeitos, numPistas, numSuspeitos,
+                              0xD1B54A32D192ED03ULL, &jogando };
+        threadMestre(&mestre);
+    }
+    size_t consultas = 0, sustentadas = 0;
+    for (int i = 0; i < numJogadores; i++) {
+        pthread_join(ids[i], NULL);
+        consultas += jogadores[i].consultas;
+        sustentadas += jogadores[i].sustentadas;
+    }
+    double segundos = agoraSegundos() - inicio;
 
-/* libera toda a arvore de salas (pos-ordem) */
-void liberarArvoreSalas(Sala *raiz) {
-    if (!raiz) return;
-    liberarArvoreSalas(raiz->esq);
-    liberarArvoreSalas(raiz->dir);
-    free(raiz);
+    uint64_t versaoFinal = atomic_load(&mapa.atual)->numero;
+    size_t publicadas = mapa.publicadas;
+    liberarMapaCompartilhado(&mapa);
+    fprintf(stderr, "Multijogador: %d jogadores, %zu partidas (%zu sustentadas), %zu consultas em %.2f ms: "
+                    "%.0f consultas/s\n",
+            numJogadores, (size_t) numJogadores * rodadas, sustentadas, consultas, segundos * 1000.0,
+            segundos > 0 ? consultas / segundos : 0.0);
+    fprintf(stderr, "Mapa de pistas: %zu versoes publicadas (final: %llu), %zu liberadas\n",
+            publicadas, (unsigned long long) versaoFinal, mapa.liberadas);
+    free(ids);
+    free(jogadores);
+    free(pistas);
+    free(suspeitos);
 }
 
 /* ===========================
-   FUNCOES DA BST DE PISTAS
+   SERVIDOR (socket Unix + epoll)
    =========================== */
 
 /*
- * inserirPista() – insere a pista coletada na BST de forma ordenada.
- * Ignora duplicatas (nao insere duas vezes a mesma pista).
- * Retorna a raiz atualizada.
+ * Protocolo por linhas; cada comando recebe exatamente uma linha de resposta.
+ * Ao conectar, o servidor ja envia a sala inicial (o hall).
+ *   e | d        -> SALA nome|pista|esquerda|direita   (campo vazio = nao ha)
+ *                   ou ERRO caminho bloqueado
+ *   p            -> PISTAS p1;p2;...                   (ordem alfabetica)
+ *   r            -> RANKING nome:qtd;nome:qtd;...
+ *   a <suspeito> -> VEREDITO qtd SUSTENTADA|FRAGIL     (e encerra a conexao)
+ *   s            -> FIM                                (e encerra a conexao)
+ *
+ * Cada trabalhador tem seu proprio epoll e aceita conexoes do mesmo socket de
+ * escuta; a conexao fica com quem a aceitou, entao o estado da sessao nunca e
+ * compartilhado. Mansao, pool e mapa pista -> suspeito sao carregados uma vez
+ * e so lidos.
  */
-PistaNode* inserirPista(PistaNode *raiz, const char *pista) {
-    if (pista == NULL || pista[0] == '\0') return raiz; /* nada a inserir */
 
-    if (raiz == NULL) {
-        PistaNode *novo = (PistaNode*) malloc(sizeof(PistaNode));
-        if (!novo) {
-            fprintf(stderr, "Erro: falha ao alocar memoria para PistaNode\n");
-            exit(1);
+#ifdef __linux__
+
+#define SERVIDOR_MAX_LINHA 256    /* comando mais longo aceito */
+#define SERVIDOR_MAX_EVENTOS 64
+#define CARGA_MAX_RESPOSTA 4096   /* resposta mais longa que o gerador aceita */
+
+static _Atomic int servidorParar = 0; /* atomico sem trava: vale no tratador de sinal e entre threads */
+
+static void sinalParar(int sinal) {
+    (void) sinal;
+    atomic_store(&servidorParar, 1);
+}
+
+typedef struct ConexaoJogo {
+    int fd;
+    uint32_t sala;                /* indice em Mansao.salas */
+    Investigacao inv;
+    char entrada[SERVIDOR_MAX_LINHA];
+    size_t tamEntrada;
+    BufferSaida saida;
+    size_t enviado;               /* bytes de 'saida' ja enviados */
+    int encerrar;                 /* fechar assim que a saida terminar */
+    int esperandoEscrita;         /* EPOLLOUT registrado */
+    struct ConexaoJogo *ant, *prox;
+} ConexaoJogo;
+
+typedef struct {
+    int epfd;
+    int escuta;
+    const Mansao *m;
+    const HashTable *ht;
+    const InternPool *pool;
+    ConexaoJogo *conexoes;        /* abertas neste trabalhador */
+    size_t sessoes;               /* conexoes encerradas */
+    size_t comandos;
+} TrabalhadorServidor;
+
+static void saidaAnexar(BufferSaida *b, const char *s, size_t n) {
+    bufferReservar(b, n);
+    memcpy(b->dados + b->tam, s, n);
+    b->tam += n;
+}
+
+static void saidaTexto(BufferSaida *b, const char *s) {
+    saidaAnexar(b, s, strlen(s));
+}
+
+/* entra na sala: registra a pista e responde com a linha SALA */
+static void entrarSalaServidor(TrabalhadorServidor *t, ConexaoJogo *c, uint32_t sala) {
+    const Sala *s = &t->m->salas[sala];
+    c->sala = sala;
+    if (s->pista != ID_VAZIO) registrarPista(&c->inv, t->pool, t->ht, s->pista);
+    saidaTexto(&c->saida, "SALA ");
+    saidaTexto(&c->saida, internTexto(t->pool, s->nome));
+    saidaTexto(&c->saida, "|");
+    saidaTexto(&c->saida, internTexto(t->pool, s->pista));
+    saidaTexto(&c->saida, "|");
+    if (s->esq) saidaTexto(&c->saida, internTexto(t->pool, s->esq->nome));
+    saidaTexto(&c->saida, "|");
+    if (s->dir) saidaTexto(&c->saida, internTexto(t->pool, s->dir->nome));
+    saidaTexto(&c->saida, "\n");
+}
+
+typedef struct {
+    BufferSaida *saida;
+    const InternPool *pool;
+    int primeira;
+} ListaPistasServidor;
+
+static void anexarPista_callback(uint32_t pista, void *ctx) {
+    ListaPistasServidor *l = (ListaPistasServidor*) ctx;
+    if (!l->primeira) saidaTexto(l->saida, ";");
+    saidaTexto(l->saida, internTexto(l->pool, pista));
+    l->primeira = 0;
+}
+
+/* executa um comando (linha sem '\n') e anexa a resposta na saida da conexao */
+static void processarComando(TrabalhadorServidor *t, ConexaoJogo *c, char *linha) {
+    size_t len = strlen(linha);
+    if (len > 0 && linha[len - 1] == '\r') linha[--len] = '\0';
+    const Sala *s = &t->m->salas[c->sala];
+    char num[48];
+    t->comandos++;
+
+    if (strcmp(linha, "e") == 0 || strcmp(linha, "d") == 0) {
+        const Sala *proxima = linha[0] == 'e' ? s->esq : s->dir;
+        if (proxima) entrarSalaServidor(t, c, (uint32_t)(proxima - t->m->salas));
+        else saidaTexto(&c->saida, "ERRO caminho bloqueado\n");
+    } else if (strcmp(linha, "p") == 0) {
+        ListaPistasServidor l = { &c->saida, t->pool, 1 };
+        saidaTexto(&c->saida, "PISTAS ");
+        bst_traverse_inorder(&c->inv.pistas, anexarPista_callback, &l);
+        saidaTexto(&c->saida, "\n");
+    } else if (strcmp(linha, "r") == 0) {
+        LinhaRanking *ranking;
+        size_t k = montarRanking(&c->inv, t->pool, &ranking);
+        saidaTexto(&c->saida, "RANKING ");
+        for (size_t i = 0; i < k; i++) {
+            if (i) saidaTexto(&c->saida, ";");
+            saidaTexto(&c->saida, ranking[i].nome);
+            snprintf(num, sizeof(num), ":%u", ranking[i].pistas);
+            saidaTexto(&c->saida, num);
         }
-        strncpy(novo->pista, pista, MAX_PISTA - 1);
-        novo->pista[MAX_PISTA - 1] = '\0';
-        novo->esq = novo->dir = NULL;
-        return novo;
+        saidaTexto(&c->saida, "\n");
+        free(ranking);
+    } else if (linha[0] == 'a' && linha[1] == ' ') {
+        int qtd = verificarSuspeitoFinal(&c->inv, internBuscar(t->pool, linha + 2));
+        snprintf(num, sizeof(num), "VEREDITO %d %s\n", qtd, qtd >= 2 ? "SUSTENTADA" : "FRAGIL");
+        saidaTexto(&c->saida, num);
+        c->encerrar = 1;
+    } else if (strcmp(linha, "s") == 0) {
+        saidaTexto(&c->saida, "FIM\n");
+        c->encerrar = 1;
+    } else {
+        saidaTexto(&c->saida, "ERRO comando desconhecido\n");
     }
+}
 
-    int cmp = strcmp(pista, raiz->pista);
-    if (cmp < 0) {
-        raiz->esq = inserirPista(raiz->esq, pista);
-    } else if (cmp > 0) {
-        raiz->dir = inserirPista(raiz->dir, pista);
-    } else {
-        /* duplicata: nao insere novamente */
+static void fecharConexao(TrabalhadorServidor *t, ConexaoJogo *c) {
+    if (epoll_ctl(t->epfd, EPOLL_CTL_DEL, c->fd, NULL) != 0)
+        fprintf(stderr, "Aviso: falha ao remover conexao do epoll\n"); /* o close abaixo tira o fd do epoll de qualquer forma */
+    close(c->fd);
+    if (c->ant) c->ant->prox = c->prox;
+    else t->conexoes = c->prox;
+    if (c->prox) c->prox->ant = c->ant;
+    liberarInvestigacao(&c->inv);
+    free(c->saida.dados);
+    free(c);
+    t->sessoes++;
+}
+
+/* envia o que estiver pendente; retorna 0 se a conexao foi fechada */
+static int enviarPendente(TrabalhadorServidor *t, ConexaoJogo *c) {
+    while (c->enviado < c->saida.tam) {
+        ssize_t n = send(c->fd, c->saida.dados + c->enviado, c->saida.tam - c->enviado, MSG_NOSIGNAL);
+        if (n > 0) {
+            c->enviado += (size_t) n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            if (!c->esperandoEscrita) {
+                struct epoll_event ev = { EPOLLIN | EPOLLOUT, { .ptr = c } };
+                if (epoll_ctl(t->epfd, EPOLL_CTL_MOD, c->fd, &ev) != 0) {
+                    fprintf(stderr, "Erro: falha ao atualizar conexao no epoll\n"); /* sem EPOLLOUT o resto nunca seria enviado */
+                    fecharConexao(t, c);
+                    return 0;
+                }
+                c->esperandoEscrita = 1;
+            }
+            return 1;
+        } else {
+            fecharConexao(t, c);
+            return 0;
+        }
+    }
+    c->saida.tam = c->enviado = 0;
+    if (c->encerrar) {
+        fecharConexao(t, c);
+        return 0;
+    }
+    if (c->esperandoEscrita) {
+        struct epoll_event ev = { EPOLLIN, { .ptr = c } };
+        if (epoll_ctl(t->epfd, EPOLL_CTL_MOD, c->fd, &ev) != 0) {
+            fprintf(stderr, "Erro: falha ao atualizar conexao no epoll\n"); /* com EPOLLOUT ainda ligado o trabalhador giraria em falso */
+            fecharConexao(t, c);
+            return 0;
+        }
+        c->esperandoEscrita = 0;
+    }
+    return 1;
+}
+
+/* le o que chegou e executa as linhas completas; retorna 0 se a conexao foi fechada */
+static int lerConexao(TrabalhadorServidor *t, ConexaoJogo *c) {
+    for (;;) {
+        ssize_t n = recv(c->fd, c->entrada + c->tamEntrada, sizeof(c->entrada) - c->tamEntrada, 0);
+        if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+            fecharConexao(t, c);
+            return 0;
+        }
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        c->tamEntrada += (size_t) n;
+        char *inicio = c->entrada, *fim = c->entrada + c->tamEntrada, *nl;
+        while (!c->encerrar && (nl = memchr(inicio, '\n', (size_t)(fim - inicio)))) {
+            *nl = '\0';
+            processarComando(t, c, inicio);
+            inicio = nl + 1;
+        }
+        c->tamEntrada = (size_t)(fim - inicio);
+        memmove(c->entrada, inicio, c->tamEntrada);
+        if (c->encerrar) break; /* o resto da entrada e descartado */
+        if (c->tamEntrada == sizeof(c->entrada)) {
+            saidaTexto(&c->saida, "ERRO linha longa demais\n");
+            c->encerrar = 1;
+            break;
+        }
     }
-    return raiz;
+    return enviarPendente(t, c);
 }
 
-/* exibe as pistas da BST em ordem (alfabetica) */
-void exibirPistas(PistaNode *raiz) {
-    if (!raiz) return;
-    exibirPistas(raiz->esq);
-    printf(" - %s\n", raiz->pista);
-    exibirPistas(raiz->dir);
+/* aceita todas as conexoes pendentes e envia a sala inicial a cada uma */
+static void aceitarConexoes(TrabalhadorServidor *t) {
+    for (;;) {
+        int fd = accept(t->escuta, NULL, NULL);
+        if (fd < 0) return; /* EAGAIN: outro trabalhador ficou com ela, ou nao ha mais */
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        ConexaoJogo *c = (ConexaoJogo*) calloc(1, sizeof(ConexaoJogo));
+        if (!c) {
+            fprintf(stderr, "Erro: falha ao alocar conexao\n");
+            exit(1);
+        }
+        c->fd = fd;
+        struct epoll_event ev = { EPOLLIN, { .ptr = c } };
+        if (epoll_ctl(t->epfd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            fprintf(stderr, "Erro: falha ao registrar conexao no epoll\n"); /* recusa a conexao: nunca seria atendida */
+            close(fd);
+            free(c);
+            continue;
+        }
+        iniciarInvestigacao(&c->inv);
+        c->prox = t->conexoes;
+        if (t->conexoes) t->conexoes->ant = c;
+        t->conexoes = c;
+        entrarSalaServidor(t, c, 0);
+        enviarPendente(t, c);
+    }
 }
 
-/* liberta BST de pistas (pos-ordem) */
-void liberarArvorePistas(PistaNode *raiz) {
-    if (!raiz) return;
-    liberarArvorePistas(raiz->esq);
-    liberarArvorePistas(raiz->dir);
-    free(raiz);
+static void* trabalhadorServidor(void *arg) {
+    TrabalhadorServidor *t = (TrabalhadorServidor*) arg;
+    struct epoll_event eventos[SERVIDOR_MAX_EVENTOS];
+    while (!atomic_load(&servidorParar)) {
+        int n = epoll_wait(t->epfd, eventos, SERVIDOR_MAX_EVENTOS, 100); /* 100 ms para ver o pedido de parada */
+        for (int i = 0; i < n; i++) {
+            ConexaoJogo *c = (ConexaoJogo*) eventos[i].data.ptr;
+            if (!c) {
+                aceitarConexoes(t);
+                continue;
+            }
+            if ((eventos[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) && !lerConexao(t, c)) continue;
+            if (eventos[i].events & EPOLLOUT) enviarPendente(t, c);
+        }
+    }
+    while (t->conexoes) fecharConexao(t, t->conexoes);
+    return NULL;
 }
 
-/* percorre a BST e para cada pista chama uma funcao callback(pista, ctx)
-   usada para contagem por suspeito posteriormente */
-typedef void (*PistaCallback)(const char *pista, void *ctx);
+/* ---- gerador de carga ---- */
+
+typedef struct {
+    int fd;
+    char entrada[CARGA_MAX_RESPOSTA];
+    size_t tamEntrada;
+    double envio;                 /* instante do ultimo comando (< 0: aguardando a sala inicial) */
+    uint64_t x;
+} ClienteCarga;
+
+typedef struct {
+    double *latencias;            /* segundos por comando */
+    size_t numLatencias, capLatencias;
+    size_t iniciadas, concluidas, sustentadas, erros;
+    size_t sessoes;
+    int epfd;
+} EstadoCarga;
 
-void bst_traverse_inorder(PistaNode *raiz, PistaCallback cb, void *ctx) {
-    if (!raiz) return;
-    bst_traverse_inorder(raiz->esq, cb, ctx);
-    cb(raiz->pista, ctx);
-    bst_traverse_inorder(raiz->dir, cb, ctx);
+/*
+ * cargaEnviar() – envia o comando inteiro (espera o socket aceitar mais dados
+ * se preciso). Retorna 1 se a sessao terminou por erro de envio, 0 caso contrario.
+ */
+static int cargaEnviar(EstadoCarga *e, ClienteCarga *c, const char *cmd) {
+    size_t tam = strlen(cmd), enviado = 0;
+    c->envio = agoraSegundos();
+    while (enviado < tam) {
+        ssize_t n = send(c->fd, cmd + enviado, tam - enviado, MSG_NOSIGNAL);
+        if (n > 0) {
+            enviado += (size_t) n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        struct pollfd p = { c->fd, POLLOUT, 0 };
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) && poll(&p, 1, 5000) > 0) continue;
+        e->erros++; /* conexao caiu ou servidor parou de ler */
+        return 1;
+    }
+    return 0;
 }
 
-/* ===========================
-   FUNCOES DA HASH (pista -> suspeito)
-   =========================== */
+static int cargaConectar(EstadoCarga *e, ClienteCarga *c, const char *caminho) {
+    struct sockaddr_un end;
+    memset(&end, 0, sizeof(end));
+    end.sun_family = AF_UNIX;
+    strncpy(end.sun_path, caminho, sizeof(end.sun_path) - 1);
+    c->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (c->fd < 0 || connect(c->fd, (struct sockaddr*) &end, sizeof(end)) != 0) {
+        fprintf(stderr, "Erro: nao foi possivel conectar a '%s'\n", caminho);
+        if (c->fd >= 0) close(c->fd);
+        c->fd = -1;
+        return 0;
+    }
+    fcntl(c->fd, F_SETFL, fcntl(c->fd, F_GETFL) | O_NONBLOCK);
+    c->tamEntrada = 0;
+    c->envio = -1.0;
+    struct epoll_event ev = { EPOLLIN, { .ptr = c } };
+    if (epoll_ctl(e->epfd, EPOLL_CTL_ADD, c->fd, &ev) != 0) {
+        fprintf(stderr, "Erro: falha ao registrar conexao de carga no epoll\n");
+        close(c->fd);
+        c->fd = -1;
+        return 0;
+    }
+    e->iniciadas++;
+    return 1;
+}
+
+/* trata uma resposta do servidor; retorna 1 quando a sessao terminou */
+static int cargaResposta(EstadoCarga *e, ClienteCarga *c, char *linha) {
+    if (c->envio >= 0) {
+        if (e->numLatencias == e->capLatencias) {
+            e->capLatencias = e->capLatencias ? e->capLatencias * 2 : 4096;
+            e->latencias = (double*) realloc(e->latencias, e->capLatencias * sizeof(double));
+            if (!e->latencias) {
+                fprintf(stderr, "Erro: falha ao alocar latencias\n");
+                exit(1);
+            }
+        }
+        e->latencias[e->numLatencias++] = agoraSegundos() - c->envio;
+    }
+    if (strncmp(linha, "SALA ", 5) == 0) {
+        /* campos: nome|pista|esquerda|direita */
+        char *campo = linha + 5;
+        for (int i = 0; i < 2 && campo; i++) {
+            campo = strchr(campo, '|');
+            if (campo) campo++;
+        }
+        int temEsq = campo && campo[0] != '|';
+        char *dir = campo ? strchr(campo, '|') : NULL;
+        int temDir = dir && dir[1] != '\0';
+        uint64_t x = proximoAleatorio(&c->x);
+        if ((!temEsq && !temDir) || x % 8 == 0) return cargaEnviar(e, c, "r\n"); /* para de explorar */
+        if (temEsq && (!temDir || (x & 16))) return cargaEnviar(e, c, "e\n");
+        return cargaEnviar(e, c, "d\n");
+    }
+    if (strncmp(linha, "RANKING", 7) == 0) {
+        /* acusa o primeiro do ranking */
+        char cmd[SERVIDOR_MAX_LINHA];
+        const char *nome = linha[7] == ' ' && linha[8] ? linha + 8 : "Ninguem";
+        size_t len = strcspn(nome, ":");
+        if (len > sizeof(cmd) - 4) len = sizeof(cmd) - 4;
+        cmd[0] = 'a';
+        cmd[1] = ' ';
+        memcpy(cmd + 2, nome, len);
+        cmd[2 + len] = '\n';
+        cmd[3 + len] = '\0';
+        return cargaEnviar(e, c, cmd);
+    }
+    if (strncmp(linha, "VEREDITO ", 9) == 0) {
+        e->concluidas++;
+        if (strstr(linha, "SUSTENTADA")) e->sustentadas++;
+    } else {
+        e->erros++;
+    }
+    return 1;
+}
+
+static int compararLatencias(const void *a, const void *b) {
+    double x = *(const double*) a, y = *(const double*) b;
+    return (x > y) - (x < y);
+}
 
-/* hash simples para strings: djb2 */
-static unsigned int hash_string(const char *str) {
-    unsigned long hash = 5381;
-    int c;
-    while ((c = (unsigned char)*str++))
-        hash = ((hash << 5) + hash) + c; /* hash * 33 + c */
-    return (unsigned int)(hash % HASH_TABLE_SIZE);
+static double segundosCPU(void) {
+    struct rusage uso;
+    if (getrusage(RUSAGE_SELF, &uso) != 0) return 0.0;
+    return (double) uso.ru_utime.tv_sec + uso.ru_utime.tv_usec / 1e6 +
+           (double) uso.ru_stime.tv_sec + uso.ru_stime.tv_usec / 1e6;
 }
 
 /*
- * inserirNaHash() – insere associacao pista -> suspeito na tabela hash.
- * Se ja existir a pista, sobrescreve o suspeito (nao deveria ocorrer no uso normal).
+ * executarCarga() – abre 'conexoes' sessoes simultaneas contra o servidor em
+ * 'caminho' e joga 'sessoes' partidas no total (desce por um caminho aleatorio,
+ * pede o ranking e acusa o primeiro). Reporta sessoes/s, sessoes por segundo
+ * de CPU do processo e a latencia por comando (p50/p99/max) em stderr.
  */
-void inserirNaHash(HashTable *ht, const char *pista, const char *suspeito) {
-    if (!pista || pista[0] == '\0') return;
-    unsigned int idx = hash_string(pista);
-    HashEntry *cur = ht->buckets[idx];
-    while (cur) {
-        if (strcmp(cur->pista, pista) == 0) {
-            /* sobrescrever suspeito */
-            strncpy(cur->suspeito, suspeito, MAX_NOME - 1);
-            cur->suspeito[MAX_NOME - 1] = '\0';
-            return;
+int executarCarga(const char *caminho, size_t sessoes, int conexoes) {
+    if (conexoes < 1) conexoes = 1;
+    if ((size_t) conexoes > sessoes) conexoes = sessoes ? (int) sessoes : 1;
+    EstadoCarga e;
+    memset(&e, 0, sizeof(e));
+    e.sessoes = sessoes;
+    e.epfd = epoll_create1(0);
+    ClienteCarga *clientes = (ClienteCarga*) calloc((size_t) conexoes, sizeof(ClienteCarga));
+    if (e.epfd < 0 || !clientes) {
+        fprintf(stderr, "Erro: falha ao iniciar gerador de carga\n");
+        exit(1);
+    }
+    double cpu0 = segundosCPU(), inicio = agoraSegundos();
+    int ativos = 0, ok = 1;
+    for (int i = 0; i < conexoes && ok; i++) {
+        clientes[i].x = 0x9E3779B97F4A7C15ULL * (uint64_t)(i + 1);
+        ok = cargaConectar(&e, &clientes[i], caminho);
+        ativos += ok;
+    }
+    struct epoll_event eventos[SERVIDOR_MAX_EVENTOS];
+    while (ativos > 0) {
+        int n = epoll_wait(e.epfd, eventos, SERVIDOR_MAX_EVENTOS, 5000);
+        if (n == 0) {
+            fprintf(stderr, "Erro: servidor parou de responder\n");
+            ok = 0;
+            break;
+        }
+        for (int i = 0; i < n; i++) {
+            ClienteCarga *c = (ClienteCarga*) eventos[i].data.ptr;
+            ssize_t r = recv(c->fd, c->entrada + c->tamEntrada, sizeof(c->entrada) - c->tamEntrada, 0);
+            if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) continue;
+            if (r > 0) c->tamEntrada += (size_t) r;
+            int terminou = 0;
+            char *nl;
+            while (!terminou && (nl = memchr(c->entrada, '\n', c->tamEntrada))) {
+                *nl = '\0';
+                terminou = cargaResposta(&e, c, c->entrada);
+                c->tamEntrada -= (size_t)(nl + 1 - c->entrada);
+                memmove(c->entrada, nl + 1, c->tamEntrada);
+            }
+            if (!terminou && (r <= 0 || c->tamEntrada == sizeof(c->entrada))) {
+                e.erros++; /* conexao caiu ou resposta longa demais */
+                terminou = 1;
+            }
+            if (!terminou) continue;
+            if (epoll_ctl(e.epfd, EPOLL_CTL_DEL, c->fd, NULL) != 0)
+                fprintf(stderr, "Aviso: falha ao remover conexao do epoll\n"); /* o close abaixo tira o fd do epoll de qualquer forma */
+            close(c->fd);
+            ativos--;
+            if (ok && e.iniciadas < e.sessoes) {
+                ok = cargaConectar(&e, c, caminho);
+                ativos += ok;
+            }
         }
-        cur = cur->prox;
     }
-    /* nao encontrado: insere novo entry no inicio do bucket */
-    HashEntry *novo = (HashEntry*) malloc(sizeof(HashEntry));
-    if (!novo) {
-        fprintf(stderr, "Erro: falha ao alocar HashEntry\n");
-        exit(1);
+    double segundos = agoraSegundos() - inicio, cpu = segundosCPU() - cpu0;
+
+    qsort(e.latencias, e.numLatencias, sizeof(double), compararLatencias);
+    double p50 = 0, p99 = 0, max = 0;
+    if (e.numLatencias) {
+        p50 = e.latencias[e.numLatencias / 2];
+        p99 = e.latencias[(e.numLatencias - 1) * 99 / 100];
+        max = e.latencias[e.numLatencias - 1];
     }
-    strncpy(novo->pista, pista, MAX_PISTA - 1);
-    novo->pista[MAX_PISTA - 1] = '\0';
-    strncpy(novo->suspeito, suspeito, MAX_NOME - 1);
-    novo->suspeito[MAX_NOME - 1] = '\0';
-    novo->prox = ht->buckets[idx];
-    ht->buckets[idx] = novo;
+    fprintf(stderr, "Carga: %zu sessoes (%zu sustentadas, %zu erros) com %d conexoes em %.2f s: %.0f sessoes/s\n",
+            e.concluidas, e.sustentadas, e.erros, conexoes, segundos, segundos > 0 ? e.concluidas / segundos : 0.0);
+    fprintf(stderr, "CPU do processo: %.2f s (%d nucleo(s)): %.0f sessoes por segundo de CPU\n",
+            cpu, numeroProcessadores(), cpu > 0 ? e.concluidas / cpu : 0.0);
+    fprintf(stderr, "Latencia por comando (%zu comandos): p50 %.1f us, p99 %.1f us, max %.1f us\n",
+            e.numLatencias, p50 * 1e6, p99 * 1e6, max * 1e6);
+    free(e.latencias);
+    free(clientes);
+    close(e.epfd);
+    return ok && e.erros == 0;
 }
 
 /*
- * encontrarSuspeito() – consulta a tabela hash usando a pista como chave.
- * Retorna ponteiro para o nome do suspeito (string interna) ou NULL se nao achar.
+ * executarServidor() – atende em 'caminho' com 'numThreads' trabalhadores.
+ * Sem carga, roda ate SIGINT/SIGTERM; com 'sessoesCarga' > 0, roda o gerador
+ * de carga na thread principal e encerra quando ele termina.
+ * Retorna 1 em sucesso.
  */
-const char* encontrarSuspeito(HashTable *ht, const char *pista) {
-    if (!pista || pista[0] == '\0') return NULL;
-    unsigned int idx = hash_string(pista);
-    HashEntry *cur = ht->buckets[idx];
-    while (cur) {
-        if (strcmp(cur->pista, pista) == 0)
-            return cur->suspeito;
-        cur = cur->prox;
+int executarServidor(const char *caminho, int numThreads, const Mansao *m, const HashTable *ht,
+                     const InternPool *pool, size_t sessoesCarga, int conexoesCarga) {
+    struct sockaddr_un end;
+    if (strlen(caminho) >= sizeof(end.sun_path)) {
+        fprintf(stderr, "Erro: caminho de socket longo demais: '%s'\n", caminho);
+        return 0;
     }
-    return NULL;
-}
+    memset(&end, 0, sizeof(end));
+    end.sun_family = AF_UNIX;
+    strcpy(end.sun_path, caminho);
+    int escuta = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(caminho);
+    if (escuta < 0 || bind(escuta, (struct sockaddr*) &end, sizeof(end)) != 0 || listen(escuta, SOMAXCONN) != 0) {
+        fprintf(stderr, "Erro: nao foi possivel escutar em '%s'\n", caminho);
+        if (escuta >= 0) close(escuta);
+        return 0;
+    }
+    fcntl(escuta, F_SETFL, fcntl(escuta, F_GETFL) | O_NONBLOCK);
 
-/* libera toda a tabela hash */
-void liberarHash(HashTable *ht) {
-    for (int i = 0; i < HASH_TABLE_SIZE; i++) {
-        HashEntry *cur = ht->buckets[i];
-        while (cur) {
-            HashEntry *tmp = cur;
-            cur = cur->prox;
-            free(tmp);
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = sinalParar;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    atomic_store(&servidorParar, 0);
+
+    if (numThreads < 1) numThreads = 1;
+    TrabalhadorServidor *trab = (TrabalhadorServidor*) calloc((size_t) numThreads, sizeof(TrabalhadorServidor));
+    pthread_t *ids = (pthread_t*) malloc((size_t) numThreads * sizeof(pthread_t));
+    if (!trab || !ids) {
+        fprintf(stderr, "Erro: falha ao alocar trabalhadores do servidor\n");
+        exit(1);
+    }
+    for (int i = 0; i < numThreads; i++) {
+        TrabalhadorServidor *t = &trab[i];
+        t->epfd = epoll_create1(0);
+        t->escuta = escuta;
+        t->m = m;
+        t->ht = ht;
+        t->pool = pool;
+#ifdef EPOLLEXCLUSIVE
+        struct epoll_event ev = { EPOLLIN | EPOLLEXCLUSIVE, { .ptr = NULL } }; /* acorda um trabalhador por conexao */
+#else
+        struct epoll_event ev = { EPOLLIN, { .ptr = NULL } };
+#endif
+        if (t->epfd < 0 || epoll_ctl(t->epfd, EPOLL_CTL_ADD, escuta, &ev) != 0 ||
+            pthread_create(&ids[i], NULL, trabalhadorServidor, t) != 0) {
+            fprintf(stderr, "Erro: falha ao criar trabalhador do servidor\n");
+            exit(1);
         }
-        ht->buckets[i] = NULL;
     }
-}
+    fprintf(stderr, "Servidor escutando em '%s' com %d trabalhador(es)\n", caminho, numThreads);
 
-/* inicializa a hash (zera buckets) */
-void initHash(HashTable *ht) {
-    for (int i = 0; i < HASH_TABLE_SIZE; i++) ht->buckets[i] = NULL;
+    int ok = 1;
+    if (sessoesCarga > 0) {
+        ok = executarCarga(caminho, sessoesCarga, conexoesCarga);
+        atomic_store(&servidorParar, 1);
+    }
+    size_t sessoes = 0, comandos = 0;
+    for (int i = 0; i < numThreads; i++) {
+        pthread_join(ids[i], NULL);
+        close(trab[i].epfd);
+        sessoes += trab[i].sessoes;
+        comandos += trab[i].comandos;
+    }
+    close(escuta);
+    unlink(caminho);
+    fprintf(stderr, "Servidor encerrado: %zu sessoes, %zu comandos\n", sessoes, comandos);
+    free(trab);
+    free(ids);
+    return ok;
 }
 
+#endif /* __linux__ */
+
 /* ===========================
-   FUNCOES DE EXPLORACAO E JULGAMENTO
+   BENCHMARK SINTETICO (--bench)
    =========================== */
 
 /*
- * explorarSalas() – navega pela arvore interativamente a partir de 'raiz'.
- * Para cada sala visitada, exibe a pista (se houver) e adiciona a BST de pistas.
+ * Mede as estruturas do jogo com 10^3 ate 10^k entradas (semente fixa) e tres
+ * distribuicoes de chaves (textos de pista):
+ *   aleatoria  - textos com sufixo pseudoaleatorio;
+ *   ordenada   - textos em ordem crescente (pior caso de uma BST sem balanceamento);
+ *   colidente  - grupos de 64 textos com o mesmo djb2: os blocos "ab" e "bA"
+ *                tem o mesmo djb2 (33*'a'+'b' == 33*'b'+'A'), entao trocar um
+ *                pelo outro nao muda o hash.
+ * Saida CSV em stdout, uma linha por operacao:
+ *   distribuicao,n,operacao,ns_op,sondagem_media,sondagem_max,bytes_por_entrada,profundidade
  */
-void explorarSalas(Sala *raiz, PistaNode **arvorePistas) {
-    if (!raiz) return;
 
-    Sala *atual = raiz;
-    char linha[32];
+#define BENCH_SEMENTE 0x5EED5EEDULL
+#define BENCH_SUSPEITOS 6
 
-    printf("Iniciando exploracao (comandos: e = esquerda, d = direita, s = sair)\n");
+/* estatisticas de sondagem: distancia media e maxima das entradas ate a posicao ideal */
+void estatisticasHash(const HashTable *ht, double *media, size_t *maximo) {
+    size_t soma = 0, max = 0;
+    for (size_t i = 0; i < ht->capacidade; i++) {
+        if (!ht->slots[i].hash) continue;
+        size_t d = distanciaSondagem(ht, ht->slots[i].hash, i);
+        soma += d;
+        if (d > max) max = d;
+    }
+    *media = ht->quantidade ? (double) soma / (double) ht->quantidade : 0.0;
+    *maximo = max;
+}
 
-    while (atual) {
-        printf("\nVoce entrou em: %s\n", atual->nome);
-        if (atual->pista[0] != '\0') {
-            printf("Pista encontrada: \"%s\"\n", atual->pista);
-            *arvorePistas = inserirPista(*arvorePistas, atual->pista);
+/* gera as 'n' chaves da distribuicao num buffer unico; inicio[i] aponta cada uma */
+static char* gerarChavesBench(const char *dist, size_t n, size_t *inicio) {
+    size_t cap = n * 32 + 1;
+    char *buf = (char*) malloc(cap);
+    if (!buf) {
+        fprintf(stderr, "Erro: falha ao alocar chaves do benchmark\n");
+        exit(1);
+    }
+    uint64_t x = BENCH_SEMENTE;
+    size_t tam = 0;
+    for (size_t i = 0; i < n; i++) {
+        inicio[i] = tam;
+        char *d = buf + tam;
+        int len;
+        if (strcmp(dist, "aleatoria") == 0) {
+            /* o indice no fim garante chaves distintas */
+            x += 0x9E3779B97F4A7C15ULL;
+            uint64_t z = x;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            z ^= z >> 31;
+            len = sprintf(d, "Pista %08x %zu", (unsigned) z, i);
+        } else if (strcmp(dist, "ordenada") == 0) {
+            len = sprintf(d, "Pista %010zu", i);
         } else {
-            printf("Nenhuma pista nesta sala.\n");
-        }
-
-        /* se folha, apenas permitir voltar? No enunciado, nao tem voltar, apenas seguir ate sair
-           entao oferecemos opcoes conforme filhos existentes */
-        if (atual->esq == NULL && atual->dir == NULL) {
-            printf("Esta sala nao possui caminhos (no folha). Voce pode sair (s) ou encerrar exploracao.\n");
-            printf("Digite 's' para sair ou outra tecla para encerrar exploracao: ");
-            if (!fgets(linha, sizeof(linha), stdin)) break;
-            if (tolower((unsigned char)linha[0]) == 's') {
-                printf("Exploracao encerrada pelo jogador.\n");
+            /* grupo = i / 64 no prefixo; os 6 bits baixos escolhem "ab" ou "bA" por bloco */
+            len = sprintf(d, "Pista %zu ", i / 64);
+            for (int b = 0; b < 6; b++) {
+                memcpy(d + len, ((i >> b) & 1) ? "bA" : "ab", 2);
+                len += 2;
             }
-            break;
-        }
-
-        printf("Escolha um caminho:\n");
-        if (atual->esq) printf("  (e) esquerda -> %s\n", atual->esq->nome);
-        else printf("  (e) esquerda -> (bloqueado)\n");
-        if (atual->dir) printf("  (d) direita -> %s\n", atual->dir->nome);
-        else printf("  (d) direita -> (bloqueado)\n");
-        printf("  (s) sair da exploracao\n");
-        printf("Opcao: ");
-        if (!fgets(linha, sizeof(linha), stdin)) break;
-        char c = tolower((unsigned char)linha[0]);
-        if (c == 'e') {
-            if (atual->esq) atual = atual->esq;
-            else printf("Caminho a esquerda indisponivel.\n");
-        } else if (c == 'd') {
-            if (atual->dir) atual = atual->dir;
-            else printf("Caminho a direita indisponivel.\n");
-        } else if (c == 's') {
-            printf("Exploracao encerrada pelo jogador.\n");
-            break;
-        } else {
-            printf("Comando invalido. Digite 'e', 'd' ou 's'.\n");
+            d[len] = '\0';
         }
+        tam += (size_t) len + 1;
     }
+    return buf;
 }
 
-/*
- * verificarSuspeitoFinal() – verifica se ha pelo menos duas pistas que apontam
- * para o suspeito indicado pelo jogador.
- * Retorna número de pistas que apontam para ele.
- * Observação: usa a BST de pistas para obter a lista de pistas coletadas e a hash para mapear cada pista ao suspeito.
- */
+static void linhaBench(const char *dist, size_t n, const char *op, double segundos, size_t ops,
+                       double sondMedia, size_t sondMax, double bytesEntrada, int profundidade) {
+    printf("%s,%zu,%s,%.1f,%.3f,%zu,%.1f,%d\n", dist, n, op, ops ? segundos * 1e9 / (double) ops : 0.0,
+           sondMedia, sondMax, bytesEntrada, profundidade);
+}
 
-/* contexto usado durante a travessia da BST para contar as ocorrencias apontando ao acusado */
-typedef struct {
-    const char *acusado;
-    HashTable *ht;
-    int contador;
-} ContadorContext;
+/* executa todas as medicoes de uma distribuicao com 'n' entradas */
+static void benchDistribuicao(const char *dist, size_t n) {
+    size_t *inicio = (size_t*) malloc(n * sizeof(size_t));
+    uint32_t *ids = (uint32_t*) malloc(n * sizeof(uint32_t));
+    if (!inicio || !ids) {
+        fprintf(stderr, "Erro: falha ao alocar benchmark\n");
+        exit(1);
+    }
+    char *chaves = gerarChavesBench(dist, n, inicio);
+    double t0, media;
+    size_t max;
 
-void contador_callback(const char *pista, void *ctx_void) {
-    ContadorContext *ctx = (ContadorContext*) ctx_void;
-    const char *sus = encontrarSuspeito(ctx->ht, pista);
-    if (sus && strcmp(sus, ctx->acusado) == 0) {
-        ctx->contador++;
+    /* internamento (hash de strings djb2 no indice do pool) */
+    InternPool pool;
+    internIniciar(&pool);
+    uint32_t suspeitos[BENCH_SUSPEITOS];
+    for (int s = 0; s < BENCH_SUSPEITOS; s++) {
+        char nome[32];
+        int len = sprintf(nome, "Suspeito %d", s);
+        suspeitos[s] = internar(&pool, nome, (size_t) len);
     }
-}
+    t0 = agoraSegundos();
+    for (size_t i = 0; i < n; i++) ids[i] = internar(&pool, chaves + inicio[i], strlen(chaves + inicio[i]));
+    double dt = agoraSegundos() - t0;
+    estatisticasHash(&pool.indice, &media, &max);
+    linhaBench(dist, n, "internar", dt, n, media, max,
+               (double)(pool.tamTexto + pool.capIds * sizeof(uint32_t) + pool.indice.capacidade * sizeof(HashSlot)) / (double) n, 0);
 
-int verificarSuspeitoFinal(PistaNode *arvorePistas, HashTable *ht, const char *acusado) {
-    if (!arvorePistas) return 0;
-    ContadorContext ctx;
-    ctx.acusado = acusado;
-    ctx.ht = ht;
-    ctx.contador = 0;
-    bst_traverse_inorder(arvorePistas, contador_callback, &ctx);
-    return ctx.contador;
-}
+    volatile uint32_t sumidouro = 0;
+    t0 = agoraSegundos();
+    for (size_t i = 0; i < n; i++) sumidouro += internBuscar(&pool, chaves + inicio[(i * 7919) % n]);
+    linhaBench(dist, n, "internBuscar_acerto", agoraSegundos() - t0, n, 0, 0, 0, 0);
 
-/* ===========================
-   UTILITARIOS
-   =========================== */
+    /* faltas: mesmo texto com o primeiro caractere trocado */
+    t0 = agoraSegundos();
+    for (size_t i = 0; i < n; i++) {
+        char *k = chaves + inicio[(i * 7919) % n];
+        char original = k[0];
+        k[0] = 'X';
+        sumidouro += internBuscar(&pool, k);
+        k[0] = original;
+    }
+    linhaBench(dist, n, "internBuscar_falha", agoraSegundos() - t0, n, 0, 0, 0, 0);
 
-/* lista as pistas coletadas (in-order), ou mensagem se nao houver */
-void mostrarPistasColetadas(PistaNode *arvorePistas) {
-    printf("\n== Pistas coletadas ==\n");
-    if (!arvorePistas) {
-        printf("(Nenhuma pista coletada)\n");
-        return;
+    /* tabela pista -> suspeito */
+    HashTable ht;
+    initHash(&ht);
+    t0 = agoraSegundos();
+    for (size_t i = 0; i < n; i++) inserirNaHash(&ht, ids[i], suspeitos[i % BENCH_SUSPEITOS]);
+    dt = agoraSegundos() - t0;
+    estatisticasHash(&ht, &media, &max);
+    linhaBench(dist, n, "inserirNaHash", dt, n, media, max,
+               (double)(ht.capacidade * sizeof(HashSlot)) / (double) n, 0);
+
+    t0 = agoraSegundos();
+    for (size_t i = 0; i < n; i++) sumidouro += encontrarSuspeito(&ht, ids[(i * 7919) % n]);
+    linhaBench(dist, n, "encontrarSuspeito", agoraSegundos() - t0, n, 0, 0, 0, 0);
+
+    /* salas: arena + ligacao numa arvore aleatoria (cada sala entra numa posicao livre) */
+    Arena arena;
+    arenaIniciar(&arena, "Sala");
+    uint32_t *livres = (uint32_t*) malloc(n * 2 * sizeof(uint32_t));
+    uint32_t *prof = (uint32_t*) malloc(n * sizeof(uint32_t));
+    if (!livres || !prof) {
+        fprintf(stderr, "Erro: falha ao alocar benchmark\n");
+        exit(1);
+    }
+    uint64_t x = BENCH_SEMENTE;
+    int profMax = 0;
+    t0 = agoraSegundos();
+    Sala *salas = (Sala*) arenaAlocarVetor(&arena, sizeof(Sala), n);
+    size_t nLivres = 0;
+    preencherSala(&salas[0], ids[0], ids[0]);
+    prof[0] = 0;
+    livres[nLivres++] = 0;
+    livres[nLivres++] = 1;
+    for (size_t i = 1; i < n; i++) {
+        size_t k = (size_t)(proximoAleatorio(&x) % nLivres);
+        uint32_t posicao = livres[k];
+        Sala *paiSala = &salas[posicao / 2];
+        preencherSala(&salas[i], ids[i], ids[i]);
+        if (posicao & 1) paiSala->dir = &salas[i];
+        else paiSala->esq = &salas[i];
+        prof[i] = prof[posicao / 2] + 1;
+        if ((int) prof[i] > profMax) profMax = (int) prof[i];
+        livres[k] = livres[--nLivres];
+        livres[nLivres++] = (uint32_t)(i * 2);
+        livres[nLivres++] = (uint32_t)(i * 2 + 1);
     }
-    exibirPistas(arvorePistas);
+    dt = agoraSegundos() - t0;
+    linhaBench(dist, n, "criarSala", dt, n, 0, 0, (double) arena.reservado / (double) n, profMax);
+    free(livres);
+    free(prof);
+
+    /* arvore de pistas: insercao na ordem da distribuicao */
+    Investigacao inv;
+    iniciarInvestigacao(&inv);
+    t0 = agoraSegundos();
+    for (size_t i = 0; i < n; i++) registrarPista(&inv, &pool, &ht, ids[i]);
+    dt = agoraSegundos() - t0;
+    linhaBench(dist, n, "inserirPista", dt, n, 0, 0,
+               (double)(inv.pistas.capacidade * sizeof(PistaNode)) / (double) n,
+               inv.pistas.nos[inv.pistas.raiz].altura);
+
+    t0 = agoraSegundos();
+    for (size_t i = 0; i < n; i++) sumidouro += (uint32_t) verificarSuspeitoFinal(&inv, suspeitos[i % BENCH_SUSPEITOS]);
+    linhaBench(dist, n, "verificarSuspeitoFinal", agoraSegundos() - t0, n, 0, 0, 0, 0);
+    (void) sumidouro;
+
+    liberarInvestigacao(&inv);
+    arenaLiberar(&arena);
+    liberarHash(&ht);
+    internLiberar(&pool);
+    free(chaves);
+    free(ids);
+    free(inicio);
 }
 
-/* transforma uma string removendo newline no fim */
-void chomp(char *s) {
-    size_t L = strlen(s);
-    if (L == 0) return;
-    if (s[L-1] == '\n') s[L-1] = '\0';
+/* executarBench() – roda todas as distribuicoes para n = 10^3 .. maxN (potencias de 10) */
+void executarBench(size_t maxN) {
+    static const char *distribuicoes[] = { "aleatoria", "ordenada", "colidente" };
+    printf("distribuicao,n,operacao,ns_op,sondagem_media,sondagem_max,bytes_por_entrada,profundidade\n");
+    for (size_t n = 1000; n <= maxN; n *= 10) {
+        for (size_t d = 0; d < sizeof(distribuicoes) / sizeof(distribuicoes[0]); d++) {
+            benchDistribuicao(distribuicoes[d], n);
+            fflush(stdout);
+        }
+    }
 }
 
 /* ===========================
    MAIN - monta mapa, popula hash e executa fluxo
    =========================== */
 
-int main(void) {
-    /* construir mansao (mapa fixo) - as pistas estao embutidas nas salas */
-    Sala *hall = criarSala("Hall de Entrada", "Pegadas sujas perto da janela");
-    Sala *salaEstar = criarSala("Sala de Estar", "Retrato pendurado torto");
-    Sala *cozinha = criarSala("Cozinha", "Vasilha quebrada no chao");
-    Sala *biblioteca = criarSala("Biblioteca", "Livro com anotacoes na margem");
-    Sala *escritorio = criarSala("Escritorio", "Caneta com tinta vermelha");
-    Sala *quarto = criarSala("Quarto", "Fio de tecido azul");
-    Sala *sotao = criarSala("Sotao", "Chave enferrujada");
-    Sala *jardim = criarSala("Jardim", "Pegadas que levam ao portao");
-
-    /* montar ligacoes (arvore binaria) */
-    hall->esq = salaEstar;
-    hall->dir = cozinha;
+int main(int argc, char **argv) {
+    const char *arqMansao = NULL;
+    const char *arqConverter = NULL;
+    const char *arqGerar = NULL;
+    const char *arqLote = NULL;
+    const char *arqSaida = NULL;
+    const char *arqSessoes = NULL;
+    const char *caminho = NULL;
+    const char *acusado = NULL;
+    const char *consulta = NULL;
+    const char *arqSessao = NULL;
+    const char *sockServidor = NULL;
+    const char *sockCarga = NULL;
+    long sessoesCarga = 0;
+    const char *arqBase = NULL;
+    const char *arqGerarBase = NULL;
+    long capCache = BASE_CACHE_PADRAO;
+    int conexoesCarga = 0;
+    int resolver = 0;
+    long benchMax = 0;
+    int numJogadores = 0;
+    long rodadas = 0;
+    long repeticoes = 1;
+    long salasGerar = 0;
+    long numSessoes = 0;
+    int numThreads = numeroProcessadores();
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--mansao") == 0 && i + 1 < argc) {
+            arqMansao = argv[++i];
+        } else if (strcmp(argv[i], "--converter") == 0 && i + 1 < argc) {
+            arqConverter = argv[++i];
+        } else if (strcmp(argv[i], "--gerar") == 0 && i + 2 < argc) {
+            salasGerar = atol(argv[++i]);
+            arqGerar = argv[++i];
+        } else if (strcmp(argv[i], "--lote") == 0 && i + 1 < argc) {
+            arqLote = argv[++i];
+        } else if (strcmp(argv[i], "--saida") == 0 && i + 1 < argc) {
+            arqSaida = argv[++i];
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            numThreads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--caminho") == 0 && i + 1 < argc) {
+            caminho = argv[++i];
+        } else if (strcmp(argv[i], "--bench") == 0) {
+            benchMax = 10000000;
+            if (i + 1 < argc && argv[i + 1][0] != '-') benchMax = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--multijogador") == 0 && i + 2 < argc) {
+            numJogadores = atoi(argv[++i]);
+            rodadas = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--servidor") == 0 && i + 1 < argc) {
+            sockServidor = argv[++i];
+        } else if (strcmp(argv[i], "--carga") == 0 && i + 3 < argc) {
+            sockCarga = argv[++i];
+            sessoesCarga = atol(argv[++i]);
+            conexoesCarga = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--base") == 0 && i + 1 < argc) {
+            arqBase = argv[++i];
+        } else if (strcmp(argv[i], "--gerar-base") == 0 && i + 1 < argc) {
+            arqGerarBase = argv[++i];
+        } else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc) {
+            capCache = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--sessao") == 0 && i + 1 < argc) {
+            arqSessao = argv[++i];
+        } else if (strcmp(argv[i], "--resolver") == 0) {
+            resolver = 1;
+        } else if (strcmp(argv[i], "--buscar") == 0 && i + 1 < argc) {
+            consulta = argv[++i];
+        } else if (strcmp(argv[i], "--acusar") == 0 && i + 1 < argc) {
+            acusado = argv[++i];
+        } else if (strcmp(argv[i], "--repetir") == 0 && i + 1 < argc) {
+            repeticoes = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--gerar-sessoes") == 0 && i + 2 < argc) {
+            numSessoes = atol(argv[++i]);
+            arqSessoes = argv[++i];
+        } else {
+            fprintf(stderr, "Uso: %s [--mansao arquivo] [--converter saida.dqb] [--gerar salas arquivo]\n"
+                            "          [--lote sessoes [--saida arquivo] [--threads n]] [--gerar-sessoes n arquivo]\n"
+                            "          [--caminho eedd [--acusar nome] [--repetir n]] [--buscar palavras]\n"
+                            "          [--resolver] [--bench [n_max]] [--multijogador jogadores partidas]\n"
+                            "          [--sessao arquivo] [--servidor socket [--threads n]]\n"
+                            "          [--carga socket sessoes conexoes] [--gerar-base arquivo]\n"
+                            "          [--base arquivo [--cache entradas]]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
 
-    salaEstar->esq = biblioteca;
-    salaEstar->dir = escritorio;
+    if (benchMax > 0) {
+        executarBench((size_t) benchMax);
+        return 0;
+    }
 
-    cozinha->esq = quarto;
-    cozinha->dir = sotao;
+    if (arqBase && (arqConverter || resolver || consulta || numJogadores || arqGerarBase)) {
+        fprintf(stderr, "Erro: --base nao combina com modos que percorrem o mapa inteiro "
+                        "(--converter, --resolver, --buscar, --multijogador, --gerar-base)\n");
+        return 1;
+    }
+    if (sockCarga && sockServidor && strcmp(sockCarga, sockServidor) != 0) {
+        fprintf(stderr, "Erro: --carga junto com --servidor deve usar o mesmo socket\n");
+        return 1;
+    }
+#ifndef __linux__
+    if (sockServidor || sockCarga) {
+        fprintf(stderr, "Erro: servidor e gerador de carga exigem Linux (epoll)\n");
+        return 1;
+    }
+#else
+    /* gerador sozinho: nao precisa da mansao, joga contra um servidor ja rodando */
+    if (sockCarga && !sockServidor)
+        return executarCarga(sockCarga, sessoesCarga > 0 ? (size_t) sessoesCarga : 0, conexoesCarga) ? 0 : 1;
+#endif
 
-    biblioteca->esq = NULL;
-    library: ; /* empty label to avoid unused label? (not needed) */
+    if (arqGerar)
+        return gerarMansaoTexto(arqGerar, salasGerar > 0 ? (size_t) salasGerar : 0, (uint64_t) time(NULL)) ? 0 : 1;
 
-    /* jardim nao ligado em exemplo, podemos colocar sotao->dir = jardim para ter mais salas */
-    sotao->dir = jardim;
+    /* carregar mansao (arquivo ou mapa padrao) e popular hash pista -> suspeito
+       (essas ligacoes sao definidas pelo designer do jogo no arquivo da mansao) */
+    double inicio = agoraSegundos();
+    /* cada tipo de no vem da sua arena; o fim do jogo libera tudo de uma vez */
+    Arena arenaSalas;
+    arenaIniciar(&arenaSalas, "Sala");
+    Arena *const arenas[] = { &arenaSalas };
+    const int numArenas = (int)(sizeof(arenas) / sizeof(arenas[0]));
 
-    /* inicializar BST de pistas e tabela hash (pista->suspeito) */
-    PistaNode *arvorePistas = NULL;
+    Mansao mansao;
     HashTable ht;
+    InternPool pool;
     initHash(&ht);
+    internIniciar(&pool);
+    /* com base em disco o mapa pista -> suspeito nem chega a ser montado */
+    HashTable *mapa = arqBase ? NULL : &ht;
+    int ok = arqMansao
+        ? carregarMansao(arqMansao, &arenaSalas, &pool, &mansao, mapa)
+        : carregarMansaoMemoria((const unsigned char*) MANSAO_PADRAO, sizeof(MANSAO_PADRAO) - 1,
+                                "mansao padrao", &arenaSalas, &pool, &mansao, mapa);
+    if (!ok) {
+        liberarHash(&ht);
+        internLiberar(&pool);
+        for (int i = 0; i < numArenas; i++) arenaLiberar(arenas[i]);
+        return 1;
+    }
+    if (arqBase) /* o mapa nao foi montado: as associacoes ficam na base */
+        fprintf(stderr, "Mansao carregada: %zu salas, associacoes na base '%s', em %.2f ms (pico de memoria: %ld KB)\n",
+                mansao.quantidade, arqBase, (agoraSegundos() - inicio) * 1000.0, picoMemoriaKB());
+    else
+        fprintf(stderr, "Mansao carregada: %zu salas, %zu associacoes em %.2f ms (pico de memoria: %ld KB)\n",
+                mansao.quantidade, ht.quantidade, (agoraSegundos() - inicio) * 1000.0, picoMemoriaKB());
+
+    /* com base em disco, as consultas vao para ela */
+    BasePistas *base = NULL;
+    if (arqBase) {
+        base = abrirBasePistas(arqBase, &pool, capCache > 0 ? (size_t) capCache : 1);
+        if (!base) {
+            liberarHash(&ht);
+            internLiberar(&pool);
+            for (int i = 0; i < numArenas; i++) arenaLiberar(arenas[i]);
+            return 1;
+        }
+        ht.disco = base;
+    }
 
-    /* popular hash com associacoes pista -> suspeito
-       (essas ligacoes seriam definidas pelo designer do jogo) */
-    inserirNaHash(&ht, "Pegadas sujas perto da janela", "Sr. Black");
-    inserirNaHash(&ht, "Retrato pendurado torto", "Sra. White");
-    inserirNaHash(&ht, "Vasilha quebrada no chao", "Jovem Green");
-    inserirNaHash(&ht, "Livro com anotacoes na margem", "Prof. Plum");
-    inserirNaHash(&ht, "Caneta com tinta vermelha", "Sra. White");
-    inserirNaHash(&ht, "Fio de tecido azul", "Jovem Green");
-    inserirNaHash(&ht, "Chave enferrujada", "Sr. Black");
-    inserirNaHash(&ht, "Pegadas que levam ao portao", "Sr. Black");
+    /* modos nao interativos: operam sobre a mansao carregada e encerram */
+    if (arqConverter || arqLote || arqSessoes || caminho || consulta || resolver || numJogadores ||
+        sockServidor || arqGerarBase) {
+        if (arqConverter) ok = salvarMansaoBinaria(arqConverter, &mansao, &ht, &pool);
+        if (ok && arqGerarBase) ok = salvarBasePistas(arqGerarBase, &ht, &pool);
+        if (ok && arqSessoes)
+            ok = gerarSessoes(arqSessoes, numSessoes > 0 ? (size_t) numSessoes : 0, (uint64_t) time(NULL),
+                              &mansao, &ht, &pool);
+        if (ok && arqLote) ok = executarLote(arqLote, arqSaida, numThreads, &ht, &pool);
+        if (ok && caminho) executarCaminho(&mansao, &pool, &ht, caminho, acusado, repeticoes);
+        if (ok && resolver) executarSolucionador(&mansao, &ht, &pool);
+        if (ok && numJogadores)
+            executarMultijogador(&mansao, &ht, &pool, numJogadores, rodadas > 0 ? (size_t) rodadas : 1);
+#ifdef __linux__
+        if (ok && sockServidor)
+            ok = executarServidor(sockServidor, numThreads, &mansao, &ht, &pool,
+                                  sockCarga && sessoesCarga > 0 ? (size_t) sessoesCarga : 0, conexoesCarga);
+#endif
+        if (ok && consulta) {
+            IndiceBusca ib;
+            double t0 = agoraSegundos();
+            construirIndiceBusca(&ib, &mansao, &ht, &pool);
+            fprintf(stderr, "Indice de busca: %zu pistas, %u palavras, %zu ocorrencias em %.2f ms\n",
+                    ib.numPistas, ib.numVocab, ib.numOcorrencias, (agoraSegundos() - t0) * 1000.0);
+            executarBusca(&ib, &pool, &ht, &mansao, consulta);
+            liberarIndiceBusca(&ib);
+        }
+        relatarArenas(arenas, numArenas);
+        relatarIntern(&pool);
+        if (base) {
+            relatarBasePistas(base);
+            fecharBasePistas(base);
+        }
+        liberarHash(&ht);
+        internLiberar(&pool);
+        for (int i = 0; i < numArenas; i++) arenaLiberar(arenas[i]);
+        return ok ? 0 : 1;
+    }
+
+    Investigacao inv;
+    uint32_t salaInicial = 0;
+    FILE *existente = arqSessao ? fopen(arqSessao, "rb") : NULL;
+    if (existente) {
+        /* sessao gravada: continua de onde o jogador parou */
+        fclose(existente);
+        double t0 = agoraSegundos();
+        if (!retomarSessao(arqSessao, &mansao, &pool, &inv, &salaInicial)) {
+            if (base) fecharBasePistas(base);
+            liberarHash(&ht);
+            internLiberar(&pool);
+            for (int i = 0; i < numArenas; i++) arenaLiberar(arenas[i]);
+            return 1;
+        }
+        fprintf(stderr, "Sessao retomada: %u pistas em %.3f ms\n",
+                inv.pistas.quantidade - 1, (agoraSegundos() - t0) * 1000.0);
+    } else {
+        iniciarInvestigacao(&inv);
+    }
 
     /* iniciar exploracao interativa */
-    explorarSalas(hall, &arvorePistas);
+    explorarSalas(&mansao, &mansao.salas[salaInicial], &pool, &ht, &inv, arqSessao);
 
     /* mostrar pistas coletadas em ordem alfabetica */
-    mostrarPistasColetadas(arvorePistas);
+    mostrarPistasColetadas(&pool, &inv.pistas);
+    exibirRanking(&inv, &pool);
 
     /* pedir ao jogador que acuse um suspeito */
     char input[MAX_NOME];
@@ -389,7 +4080,7 @@ int main(void) {
             printf("Nenhum suspeito indicado. Encerrando.\n");
         } else {
             /* verificar quantas pistas apontam para esse suspeito */
-            int qtd = verificarSuspeitoFinal(arvorePistas, &ht, input);
+            int qtd = verificarSuspeitoFinal(&inv, internBuscar(&pool, input));
             printf("\nPistas que apontam para '%s': %d\n", input, qtd);
             if (qtd >= 2) {
                 printf("Resultado: Ha evidencias suficientes. Acusacao sustentada!\n");
@@ -399,10 +4090,18 @@ int main(void) {
         }
     }
 
-    /* liberar memoria */
-    liberarArvoreSalas(hall);
-    liberarArvorePistas(arvorePistas);
+    /* liberar memoria: relatorio por estrutura e descarte das arenas */
+    relatarArenas(arenas, numArenas);
+    relatarArvorePistas(&inv.pistas);
+    relatarIntern(&pool);
+    if (base) {
+        relatarBasePistas(base);
+        fecharBasePistas(base);
+    }
+    liberarInvestigacao(&inv);
     liberarHash(&ht);
+    internLiberar(&pool);
+    for (int i = 0; i < numArenas; i++) arenaLiberar(arenas[i]);
 
     printf("\nFim do jogo. Obrigado por jogar Detective Quest!\n");
     return 0;
@@ -1,8 +1,29 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdint.h>
 #include <time.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <errno.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#ifdef __linux__
+#include <termios.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#endif
 
 #define TAM_FILA 5
+#define TAM_CACHE 64
 #define TAM_PILHA 3
 
 // Estrutura que representa uma peça do Tetris
@@ -11,63 +32,328 @@ typedef struct {
     int id;    // identificador único
 } Peca;
 
+// ---------------------- INSTRUMENTACAO ----------------------
+/*
+ * Contadores e histogramas de latencia por operacao, ativados apenas quando
+ * o programa e compilado com -DINSTRUMENTAR; caso contrario as macros abaixo
+ * nao geram codigo algum.
+ *
+ * Cada medicao usa o contador de ciclos (rdtsc) em x86 ou o relogio
+ * monotonico nas demais arquiteturas, e cai num balde logaritmico (balde k =
+ * duracao com k bits). Cada thread acumula numa tabela propria (sem
+ * atomicos); as threads auxiliares descarregam sua tabela na global ao
+ * terminar. O relatorio e emitido em stderr ao sair ou ao receber SIGUSR1
+ * (o sinal so marca o pedido; o laco principal o atende).
+ */
+enum {
+    OP_ENFILEIRAR,
+    OP_DESENFILEIRAR,
+    OP_EMPILHAR,
+    OP_DESEMPILHAR,
+    OP_TROCA,
+    OP_TROCA_MULTIPLA,
+    OP_GERAR_PECA,
+    OP_RENDERIZAR,
+    OP_ENTRADA,
+    NUM_OPS
+};
+
+#ifdef INSTRUMENTAR
+
+#include <signal.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define INSTR_USA_TSC 1
+#endif
+
+#define INSTR_BALDES 64
+
+static const char *NOMES_OPS[NUM_OPS] = {
+    "enfileirar", "desenfileirar", "empilhar", "desempilhar",
+    "trocarTopoComFrente", "trocaMultipla", "gerarPeca", "renderizar", "entrada (scanf)"
+};
+
+typedef struct {
+    uint64_t chamadas[NUM_OPS];
+    uint64_t soma[NUM_OPS];
+    uint64_t maximo[NUM_OPS];
+    uint64_t baldes[NUM_OPS][INSTR_BALDES];
+} TabelaInstr;
+
+static _Thread_local TabelaInstr instrLocal;
+static TabelaInstr instrGlobal;
+static pthread_mutex_t instrTrava = PTHREAD_MUTEX_INITIALIZER;
+static volatile sig_atomic_t instrPedido = 0;
+static uint64_t instrTicks0;
+static double instrSegundos0;
+
+static inline uint64_t instrTempo(void) {
+#ifdef INSTR_USA_TSC
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+#endif
+}
+
+static inline void instrRegistrar(int op, uint64_t duracao) {
+    int balde = duracao ? 64 - __builtin_clzll(duracao) : 0;
+    instrLocal.chamadas[op]++;
+    instrLocal.soma[op] += duracao;
+    if (duracao > instrLocal.maximo[op]) instrLocal.maximo[op] = duracao;
+    instrLocal.baldes[op][balde]++;
+}
+
+// Soma a tabela da thread atual na global e a zera
+static void instrDescarregar(void) {
+    pthread_mutex_lock(&instrTrava);
+    for (int op = 0; op < NUM_OPS; op++) {
+        instrGlobal.chamadas[op] += instrLocal.chamadas[op];
+        instrGlobal.soma[op] += instrLocal.soma[op];
+        if (instrLocal.maximo[op] > instrGlobal.maximo[op])
+            instrGlobal.maximo[op] = instrLocal.maximo[op];
+        for (int b = 0; b < INSTR_BALDES; b++)
+            instrGlobal.baldes[op][b] += instrLocal.baldes[op][b];
+    }
+    pthread_mutex_unlock(&instrTrava);
+    memset(&instrLocal, 0, sizeof(instrLocal));
+}
+
+// Nanossegundos por tick (1 sem TSC; com TSC, calibrado desde o inicio)
+static double instrNsPorTick(void) {
+#ifdef INSTR_USA_TSC
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    double seg = ts.tv_sec + ts.tv_nsec / 1e9 - instrSegundos0;
+    uint64_t ticks = __rdtsc() - instrTicks0;
+    return ticks > 0 && seg > 0 ? seg * 1e9 / (double) ticks : 1.0;
+#else
+    return 1.0;
+#endif
+}
+
+// Limite superior (em ticks) do balde em que cai o percentil p
+static uint64_t instrPercentil(const TabelaInstr *t, int op, double p) {
+    uint64_t alvo = (uint64_t) (p * (double) t->chamadas[op]), acumulado = 0;
+    for (int b = 0; b < INSTR_BALDES; b++) {
+        acumulado += t->baldes[op][b];
+        if (acumulado > alvo) {
+            uint64_t limite = b == 0 ? 0 : (b >= 63 ? UINT64_MAX : (1ULL << b) - 1);
+            return limite < t->maximo[op] ? limite : t->maximo[op];
+        }
+    }
+    return t->maximo[op];
+}
+
+static void instrRelatorio(void) {
+    instrDescarregar();
+    double ns = instrNsPorTick();
+    pthread_mutex_lock(&instrTrava);
+    fprintf(stderr, "\n== Instrumentacao (ns; percentis pelo limite do balde log2) ==\n");
+    fprintf(stderr, "%-20s %12s %10s %10s %10s %12s\n", "operacao", "chamadas", "media", "p50", "p99", "max");
+    for (int op = 0; op < NUM_OPS; op++) {
+        const TabelaInstr *t = &instrGlobal;
+        if (!t->chamadas[op]) continue;
+        fprintf(stderr, "%-20s %12llu %10.1f %10.0f %10.0f %12.0f\n", NOMES_OPS[op],
+                (unsigned long long) t->chamadas[op],
+                (double) t->soma[op] / (double) t->chamadas[op] * ns,
+                (double) instrPercentil(t, op, 0.50) * ns,
+                (double) instrPercentil(t, op, 0.99) * ns,
+                (double) t->maximo[op] * ns);
+        fprintf(stderr, "  histograma:");
+        for (int b = 0; b < INSTR_BALDES; b++) {
+            if (t->baldes[op][b])
+                fprintf(stderr, " <%.0f:%llu", (double) (b >= 63 ? UINT64_MAX : 1ULL << b) * ns,
+                        (unsigned long long) t->baldes[op][b]);
+        }
+        fprintf(stderr, "\n");
+    }
+    pthread_mutex_unlock(&instrTrava);
+}
+
+static void instrSinal(int sinal) {
+    (void) sinal;
+    instrPedido = 1;
+}
+
+static void instrIniciar(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    instrSegundos0 = ts.tv_sec + ts.tv_nsec / 1e9;
+    instrTicks0 = instrTempo();
+    atexit(instrRelatorio);
+#ifdef SIGUSR1
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = instrSinal;
+    sa.sa_flags = SA_RESTART;
+    sigaction(SIGUSR1, &sa, NULL);
+#endif
+}
+
+// Atende um pedido de relatorio feito por sinal
+static inline void instrVerificarSinal(void) {
+    if (instrPedido) {
+        instrPedido = 0;
+        instrRelatorio();
+    }
+}
+
+#define INSTR_INICIO(op) uint64_t instrT0_##op = instrTempo()
+#define INSTR_FIM(op) instrRegistrar(op, instrTempo() - instrT0_##op)
+#define INSTR_INICIAR() instrIniciar()
+#define INSTR_DESCARREGAR() instrDescarregar()
+#define INSTR_VERIFICAR_SINAL() instrVerificarSinal()
+
+#else
+
+#define INSTR_INICIO(op) ((void) 0)
+#define INSTR_FIM(op) ((void) 0)
+#define INSTR_INICIAR() ((void) 0)
+#define INSTR_DESCARREGAR() ((void) 0)
+#define INSTR_VERIFICAR_SINAL() ((void) 0)
+
+#endif
+
 // ---------------------- FILA CIRCULAR ----------------------
+/*
+ * Fila circular SPSC (um produtor, um consumidor) sem travas.
+ * A capacidade e escolhida na inicializacao; o buffer e arredondado para a
+ * proxima potencia de dois, de modo que o indice e obtido com uma mascara.
+ * 'frente' e 'tras' sao contadores monotonicos (a quantidade e tras - frente)
+ * em linhas de cache separadas: 'tras' so e escrito pelo produtor e 'frente'
+ * so pelo consumidor. Cada lado guarda uma copia do indice do outro para
+ * evitar ler a linha de cache alheia em toda operacao.
+ * O limite logico (filaCheia) continua sendo a capacidade pedida.
+ */
 typedef struct {
-    Peca pecas[TAM_FILA];
-    int frente;
-    int tras;
-    int quantidade;
+    Peca *pecas;
+    unsigned mascara;    // tamanho do buffer - 1
+    unsigned capacidade; // limite logico de pecas na fila
+
+    _Alignas(TAM_CACHE) atomic_uint frente; // proxima posicao a remover (consumidor)
+    unsigned trasCache;                     // ultima leitura de 'tras' pelo consumidor
+
+    _Alignas(TAM_CACHE) atomic_uint tras;   // proxima posicao a inserir (produtor)
+    unsigned frenteCache;                   // ultima leitura de 'frente' pelo produtor
 } Fila;
 
-// Inicializa a fila
-void inicializarFila(Fila *f) {
-    f->frente = 0;
-    f->tras = -1;
-    f->quantidade = 0;
+// Menor potencia de dois >= n
+static unsigned proximaPotenciaDois(unsigned n) {
+    unsigned p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+// Inicializa a fila com espaco para 'capacidade' pecas
+void inicializarFila(Fila *f, int capacidade) {
+    if (capacidade < 1) capacidade = 1;
+    unsigned tamanho = proximaPotenciaDois((unsigned) capacidade);
+    f->pecas = (Peca*) malloc(tamanho * sizeof(Peca));
+    if (!f->pecas) {
+        fprintf(stderr, "Erro: falha na alocacao da fila\n");
+        exit(1);
+    }
+    f->mascara = tamanho - 1;
+    f->capacidade = (unsigned) capacidade;
+    atomic_init(&f->frente, 0);
+    atomic_init(&f->tras, 0);
+    f->trasCache = 0;
+    f->frenteCache = 0;
+}
+
+// Libera o buffer da fila
+void liberarFila(Fila *f) {
+    free(f->pecas);
+    f->pecas = NULL;
+}
+
+// Quantidade de pecas na fila
+int filaQuantidade(Fila *f) {
+    unsigned tras = atomic_load_explicit(&f->tras, memory_order_acquire);
+    unsigned frente = atomic_load_explicit(&f->frente, memory_order_acquire);
+    return (int)(tras - frente);
+}
+
+// Peca na posicao i a partir da frente (0 = frente); uso do lado consumidor
+Peca* filaPosicao(Fila *f, int i) {
+    unsigned frente = atomic_load_explicit(&f->frente, memory_order_relaxed);
+    return &f->pecas[(frente + (unsigned) i) & f->mascara];
 }
 
 // Verifica se a fila está cheia
 int filaCheia(Fila *f) {
-    return f->quantidade == TAM_FILA;
+    return (unsigned) filaQuantidade(f) == f->capacidade;
 }
 
 // Verifica se a fila está vazia
 int filaVazia(Fila *f) {
-    return f->quantidade == 0;
+    return filaQuantidade(f) == 0;
 }
 
-// Adiciona uma peça à fila (enqueue)
+// Adiciona uma peça à fila (enqueue) - lado produtor
 void enfileirar(Fila *f, Peca p) {
-    if (filaCheia(f)) return;
-    f->tras = (f->tras + 1) % TAM_FILA;
-    f->pecas[f->tras] = p;
-    f->quantidade++;
+    INSTR_INICIO(OP_ENFILEIRAR);
+    unsigned tras = atomic_load_explicit(&f->tras, memory_order_relaxed);
+    if (tras - f->frenteCache >= f->capacidade) {
+        f->frenteCache = atomic_load_explicit(&f->frente, memory_order_acquire);
+        if (tras - f->frenteCache >= f->capacidade) {
+            INSTR_FIM(OP_ENFILEIRAR);
+            return;
+        }
+    }
+    f->pecas[tras & f->mascara] = p;
+    atomic_store_explicit(&f->tras, tras + 1, memory_order_release);
+    INSTR_FIM(OP_ENFILEIRAR);
 }
 
-// Remove uma peça da fila (dequeue)
+// Remove uma peça da fila (dequeue) - lado consumidor
 Peca desenfileirar(Fila *f) {
+    INSTR_INICIO(OP_DESENFILEIRAR);
     Peca vazia = {'-', -1};
-    if (filaVazia(f)) return vazia;
-    Peca p = f->pecas[f->frente];
-    f->frente = (f->frente + 1) % TAM_FILA;
-    f->quantidade--;
+    unsigned frente = atomic_load_explicit(&f->frente, memory_order_relaxed);
+    if (frente == f->trasCache) {
+        f->trasCache = atomic_load_explicit(&f->tras, memory_order_acquire);
+        if (frente == f->trasCache) {
+            INSTR_FIM(OP_DESENFILEIRAR);
+            return vazia;
+        }
+    }
+    Peca p = f->pecas[frente & f->mascara];
+    atomic_store_explicit(&f->frente, frente + 1, memory_order_release);
+    INSTR_FIM(OP_DESENFILEIRAR);
     return p;
 }
 
 // ---------------------- PILHA ----------------------
 typedef struct {
-    Peca pecas[TAM_PILHA];
+    Peca *pecas;
+    int capacidade;
     int topo;
 } Pilha;
 
-// Inicializa a pilha
-void inicializarPilha(Pilha *p) {
+// Inicializa a pilha com espaco para 'capacidade' pecas
+void inicializarPilha(Pilha *p, int capacidade) {
+    if (capacidade < 1) capacidade = 1;
+    p->pecas = (Peca*) malloc((size_t) capacidade * sizeof(Peca));
+    if (!p->pecas) {
+        fprintf(stderr, "Erro: falha na alocacao da pilha\n");
+        exit(1);
+    }
+    p->capacidade = capacidade;
     p->topo = -1;
 }
 
+// Libera o vetor da pilha
+void liberarPilha(Pilha *p) {
+    free(p->pecas);
+    p->pecas = NULL;
+}
+
 // Verifica se a pilha está cheia
 int pilhaCheia(Pilha *p) {
-    return p->topo == TAM_PILHA - 1;
+    return p->topo == p->capacidade - 1;
 }
 
 // Verifica se a pilha está vazia
@@ -77,163 +363,2376 @@ int pilhaVazia(Pilha *p) {
 
 // Empilha (push)
 void empilhar(Pilha *p, Peca nova) {
-    if (pilhaCheia(p)) return;
-    p->pecas[++p->topo] = nova;
+    INSTR_INICIO(OP_EMPILHAR);
+    if (!pilhaCheia(p))
+        p->pecas[++p->topo] = nova;
+    INSTR_FIM(OP_EMPILHAR);
 }
 
 // Desempilha (pop)
 Peca desempilhar(Pilha *p) {
+    INSTR_INICIO(OP_DESEMPILHAR);
     Peca vazia = {'-', -1};
-    if (pilhaVazia(p)) return vazia;
-    return p->pecas[p->topo--];
+    if (!pilhaVazia(p))
+        vazia = p->pecas[p->topo--];
+    INSTR_FIM(OP_DESEMPILHAR);
+    return vazia;
 }
 
 // ---------------------- FUNÇÕES AUXILIARES ----------------------
 
-// Gera uma nova peça com ID único e tipo aleatório
-Peca gerarPeca(int id) {
-    char tipos[] = {'I', 'O', 'T', 'L'};
+// Quando zero, as mensagens das operacoes nao sao registradas (modo em lote)
+static int saidaAtiva = 1;
+
+// Ultima mensagem de uma operacao, exibida na linha de status do proximo quadro
+static char ultimaMensagem[256];
+
+// Registra a mensagem da operacao (condicionado a saidaAtiva)
+void mensagem(const char *fmt, ...) {
+    if (!saidaAtiva) return;
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(ultimaMensagem, sizeof(ultimaMensagem), fmt, args);
+    va_end(args);
+    size_t n = strlen(ultimaMensagem);
+    if (n > 0 && ultimaMensagem[n - 1] == '\n') ultimaMensagem[n - 1] = '\0';
+}
+
+// Relogio monotonico em segundos (usado nas medicoes de desempenho)
+double agoraSegundos(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// ---------------------- GERADOR DE PECAS ----------------------
+/*
+ * Gerador deterministico baseado em contador: o tipo da peca de id N e uma
+ * funcao pura de (semente, N), calculada com o finalizador do splitmix64.
+ * Assim a mesma semente reproduz exatamente a mesma sequencia, qualquer
+ * thread pode gerar qualquer trecho sem estado compartilhado, e o laco de
+ * geracao em bloco nao tem dependencia entre iteracoes (vetorizavel).
+ *
+ * Modos:
+ *  - GERADOR_UNIFORME: cada peca sorteada independentemente. Como ha 4
+ *    tipos, usam-se os 2 bits mais altos do valor misturado (sem vies de modulo).
+ *  - GERADOR_SACO: a sequencia e dividida em "sacos" com um exemplar de cada
+ *    tipo, embaralhados (Fisher-Yates) a partir do numero do saco.
+ */
+#define NUM_TIPOS 4
+
+static const char TIPOS_PECA[NUM_TIPOS] = {'I', 'O', 'T', 'L'};
+
+// Indice (0 a NUM_TIPOS - 1) do tipo da peca
+static int tipoIndice(char tipo) {
+    for (int i = 0; i < NUM_TIPOS; i++)
+        if (TIPOS_PECA[i] == tipo) return i;
+    return 0;
+}
+
+typedef enum {
+    GERADOR_UNIFORME,
+    GERADOR_SACO
+} ModoGerador;
+
+typedef struct {
+    uint64_t semente;
+    ModoGerador modo;
+} Gerador;
+
+void inicializarGerador(Gerador *g, uint64_t semente, ModoGerador modo) {
+    g->semente = semente;
+    g->modo = modo;
+}
+
+// Finalizador do splitmix64
+static inline uint64_t misturar64(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+// Valor pseudoaleatorio de 64 bits associado ao indice n
+static inline uint64_t sorteio(const Gerador *g, uint64_t n) {
+    return misturar64(g->semente ^ (n * 0xD1B54A32D192ED03ULL));
+}
+
+// Preenche 'saco' com a permutacao dos tipos correspondente ao saco de numero n
+static void embaralharSaco(const Gerador *g, uint64_t n, char saco[NUM_TIPOS]) {
+    uint64_t h = sorteio(g, ~n);
+    for (int i = 0; i < NUM_TIPOS; i++) saco[i] = TIPOS_PECA[i];
+    for (int i = NUM_TIPOS - 1; i > 0; i--) {
+        // indice em [0, i] pelo metodo multiplicativo (sem divisao)
+        int j = (int)(((h & 0xFFFFFFFFULL) * (uint64_t)(i + 1)) >> 32);
+        char t = saco[i]; saco[i] = saco[j]; saco[j] = t;
+        h = misturar64(h);
+    }
+}
+
+// Gera uma nova peça com ID único; o tipo depende apenas do gerador e do id
+Peca gerarPeca(const Gerador *g, int id) {
+    INSTR_INICIO(OP_GERAR_PECA);
     Peca nova;
-    nova.tipo = tipos[rand() % 4];
     nova.id = id;
+    if (g->modo == GERADOR_SACO) {
+        char saco[NUM_TIPOS];
+        embaralharSaco(g, (uint64_t) id / NUM_TIPOS, saco);
+        nova.tipo = saco[id % NUM_TIPOS];
+    } else {
+        nova.tipo = TIPOS_PECA[sorteio(g, (uint64_t) id) >> 62];
+    }
+    INSTR_FIM(OP_GERAR_PECA);
     return nova;
 }
 
-// Exibe o estado atual da fila e da pilha
-void exibirEstado(Fila *f, Pilha *p) {
-    printf("\n-----------------------------\n");
-    printf("Fila de pecas futuras:\n");
-    for (int i = 0; i < f->quantidade; i++) {
-        int idx = (f->frente + i) % TAM_FILA;
-        printf("[%c %d] ", f->pecas[idx].tipo, f->pecas[idx].id);
+// Gera n pecas consecutivas (ids primeiroId .. primeiroId + n - 1) em buf.
+// Produz exatamente o mesmo resultado que n chamadas a gerarPeca.
+void gerarPecas(const Gerador *g, Peca *buf, int n, int primeiroId) {
+    if (g->modo == GERADOR_UNIFORME) {
+        for (int i = 0; i < n; i++) {
+            buf[i].id = primeiroId + i;
+            buf[i].tipo = TIPOS_PECA[sorteio(g, (uint64_t)(primeiroId + i)) >> 62];
+        }
+        return;
+    }
+
+    // modo saco: um embaralhamento por saco, copiado para as posicoes cobertas
+    int i = 0;
+    while (i < n) {
+        int id = primeiroId + i;
+        char saco[NUM_TIPOS];
+        embaralharSaco(g, (uint64_t) id / NUM_TIPOS, saco);
+        for (int k = id % NUM_TIPOS; k < NUM_TIPOS && i < n; k++, i++) {
+            buf[i].id = primeiroId + i;
+            buf[i].tipo = saco[k];
+        }
+    }
+}
+
+// ---------------------- PONTUACAO ----------------------
+
+// Pontos por peca usada (jogada da fila ou da reserva)
+#define PONTOS_PECA 10
+// Bonus quando a peca usada tem o mesmo tipo da anterior (combo)
+#define BONUS_COMBO 15
+
+// Pontua o uso de uma peca e atualiza o tipo da ultima peca usada
+int pontuarJogada(char tipo, int *ultimoTipo) {
+    int t = tipoIndice(tipo);
+    int pontos = PONTOS_PECA + (t == *ultimoTipo ? BONUS_COMBO : 0);
+    *ultimoTipo = t;
+    return pontos;
+}
+
+// ---------------------- RENDERIZADOR ----------------------
+/*
+ * Monta cada quadro linha a linha num buffer preparado na inicializacao e o
+ * envia ao terminal com um unico write(). Apenas as linhas que mudaram desde
+ * o quadro anterior sao reemitidas, posicionando o cursor com sequencias ANSI.
+ * 'intervaloMin' limita a taxa de quadros: pedidos de apresentacao que chegam
+ * antes do intervalo sao descartados (a menos que forcados), de modo que o
+ * desenho nunca consome o tempo da logica do jogo.
+ * Quando a saida nao e um terminal, o quadro inteiro e escrito sem cursor.
+ */
+#define REND_MAX_LINHAS 32
+#define REND_LARGURA 512
+
+typedef struct {
+    char linhas[REND_MAX_LINHAS][REND_LARGURA];     // quadro em construcao
+    char anteriores[REND_MAX_LINHAS][REND_LARGURA]; // ultimo quadro emitido
+    int numLinhas;
+    int numAnteriores;
+    char saida[REND_MAX_LINHAS * (REND_LARGURA + 24) + 64];
+    int terminal;        // 1 se a saida aceita enderecamento de cursor
+    int primeiroQuadro;
+    double intervaloMin; // segundos entre quadros (0 = sem limite)
+    double ultimoQuadro;
+    long quadros;
+    long descartados;
+    long bytes;
+} Renderizador;
+
+// fpsMax <= 0 desativa o limite de quadros
+void rendIniciar(Renderizador *r, double fpsMax, int terminal) {
+    r->numLinhas = 0;
+    r->numAnteriores = 0;
+    r->terminal = terminal;
+    r->primeiroQuadro = 1;
+    r->intervaloMin = fpsMax > 0 ? 1.0 / fpsMax : 0.0;
+    r->ultimoQuadro = 0.0;
+    r->quadros = r->descartados = r->bytes = 0;
+}
+
+// Comeca um novo quadro (vazio)
+void rendLimpar(Renderizador *r) {
+    r->numLinhas = 0;
+}
+
+// Acrescenta uma linha formatada ao quadro (truncada em REND_LARGURA - 1)
+void rendLinha(Renderizador *r, const char *fmt, ...) {
+    if (r->numLinhas == REND_MAX_LINHAS) return;
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(r->linhas[r->numLinhas++], REND_LARGURA, fmt, args);
+    va_end(args);
+}
+
+// Copia 'texto' para o buffer de saida a partir de 'pos'
+static size_t rendCopiar(Renderizador *r, size_t pos, const char *texto) {
+    size_t n = strlen(texto);
+    memcpy(r->saida + pos, texto, n);
+    return pos + n;
+}
+
+// Indica se um quadro nao forcado seria apresentado agora; permite pular a
+// montagem do quadro quando ele seria descartado pelo limite
+int rendQuadroDevido(Renderizador *r) {
+    if (r->primeiroQuadro || r->intervaloMin <= 0) return 1;
+    if (agoraSegundos() - r->ultimoQuadro >= r->intervaloMin) return 1;
+    r->descartados++;
+    return 0;
+}
+
+/*
+ * Envia o quadro montado. Retorna 1 se foi apresentado, 0 se descartado pelo
+ * limite de quadros. O cursor fica no fim da ultima linha (onde o prompt e
+ * digitado), por isso essa linha e sempre redesenhada no quadro seguinte.
+ */
+int rendApresentar(Renderizador *r, int forcar) {
+    double agora = agoraSegundos();
+    if (!forcar && !r->primeiroQuadro && agora - r->ultimoQuadro < r->intervaloMin) {
+        r->descartados++;
+        return 0;
+    }
+    INSTR_INICIO(OP_RENDERIZAR);
+
+    size_t pos = 0;
+    char comando[32];
+    if (!r->terminal) {
+        pos = rendCopiar(r, pos, "\n");
+        for (int i = 0; i < r->numLinhas; i++) {
+            pos = rendCopiar(r, pos, r->linhas[i]);
+            if (i + 1 < r->numLinhas) pos = rendCopiar(r, pos, "\n");
+        }
+    } else {
+        if (r->primeiroQuadro) pos = rendCopiar(r, pos, "\x1b[H\x1b[2J");
+        for (int i = 0; i < r->numLinhas; i++) {
+            if (!r->primeiroQuadro && i < r->numAnteriores &&
+                strcmp(r->linhas[i], r->anteriores[i]) == 0)
+                continue;
+            snprintf(comando, sizeof(comando), "\x1b[%d;1H", i + 1);
+            pos = rendCopiar(r, pos, comando);
+            pos = rendCopiar(r, pos, r->linhas[i]);
+            pos = rendCopiar(r, pos, "\x1b[K");
+        }
+        // apaga as linhas que sobraram do quadro anterior
+        for (int i = r->numLinhas; i < r->numAnteriores; i++) {
+            snprintf(comando, sizeof(comando), "\x1b[%d;1H\x1b[K", i + 1);
+            pos = rendCopiar(r, pos, comando);
+        }
+        if (r->numLinhas > 0) {
+            snprintf(comando, sizeof(comando), "\x1b[%d;%dH", r->numLinhas,
+                     (int) strlen(r->linhas[r->numLinhas - 1]) + 1);
+            pos = rendCopiar(r, pos, comando);
+        }
+    }
+
+    fflush(stdout);
+    size_t enviado = 0;
+    while (enviado < pos) {
+        ssize_t n = write(STDOUT_FILENO, r->saida + enviado, pos - enviado);
+        if (n <= 0) break;
+        enviado += (size_t) n;
+    }
+
+    memcpy(r->anteriores, r->linhas, sizeof(r->linhas[0]) * (size_t) r->numLinhas);
+    r->numAnteriores = r->numLinhas;
+    if (r->numLinhas > 0) r->anteriores[r->numLinhas - 1][0] = '\0';
+    r->primeiroQuadro = 0;
+    r->ultimoQuadro = agora;
+    r->quadros++;
+    r->bytes += (long) pos;
+    INSTR_FIM(OP_RENDERIZAR);
+    return 1;
+}
+
+// Acrescenta ao quadro as linhas com o estado atual da fila e da pilha
+void montarEstado(Renderizador *r, Fila *f, Pilha *p) {
+    char buf[REND_LARGURA];
+    size_t pos;
+
+    rendLinha(r, "-----------------------------");
+    rendLinha(r, "Fila de pecas futuras:");
+    buf[0] = '\0';
+    pos = 0;
+    int quantidade = filaQuantidade(f);
+    for (int i = 0; i < quantidade && pos < sizeof(buf) - 24; i++) {
+        Peca *pc = filaPosicao(f, i);
+        pos += (size_t) snprintf(buf + pos, sizeof(buf) - pos, "[%c %d] ", pc->tipo, pc->id);
+        if (i + 1 < quantidade && pos >= sizeof(buf) - 24)
+            snprintf(buf + pos, sizeof(buf) - pos, "...");
     }
-    printf("\n-----------------------------\n");
+    rendLinha(r, "%s", buf);
+    rendLinha(r, "-----------------------------");
 
-    printf("Pilha de reserva (Topo -> Base):\n");
+    rendLinha(r, "Pilha de reserva (Topo -> Base):");
     if (pilhaVazia(p))
-        printf("(vazia)\n");
+        rendLinha(r, "(vazia)");
     else {
-        for (int i = p->topo; i >= 0; i--) {
-            printf("[%c %d] ", p->pecas[i].tipo, p->pecas[i].id);
+        buf[0] = '\0';
+        pos = 0;
+        for (int i = p->topo; i >= 0 && pos < sizeof(buf) - 24; i--) {
+            pos += (size_t) snprintf(buf + pos, sizeof(buf) - pos, "[%c %d] ",
+                                     p->pecas[i].tipo, p->pecas[i].id);
+            if (i > 0 && pos >= sizeof(buf) - 24)
+                snprintf(buf + pos, sizeof(buf) - pos, "...");
         }
-        printf("\n");
+        rendLinha(r, "%s", buf);
     }
-    printf("-----------------------------\n");
+    rendLinha(r, "-----------------------------");
 }
 
-// Troca simples entre o topo da pilha e a frente da fila
-void trocarTopoComFrente(Fila *fila, Pilha *pilha) {
-    if (pilhaVazia(pilha) || filaVazia(fila)) {
-        printf("Nao e possivel trocar. Uma das estruturas esta vazia.\n");
-        return;
+// Exibe o estado atual da fila e da pilha (sem enderecamento de cursor)
+void exibirEstado(Fila *f, Pilha *p) {
+    static Renderizador r;
+    rendIniciar(&r, 0, 0);
+    montarEstado(&r, f, p);
+    rendLinha(&r, "");
+    rendApresentar(&r, 1);
+}
+
+// Pecas copiadas por vez pelo buffer temporario de trocarBloco
+#define TAM_BLOCO_TROCA 256
+
+/*
+ * Troca o trecho contiguo q[0..n) da fila com n pecas da pilha, pareando
+ * q[i] com s[-i] (a pilha e percorrida do topo para a base). Cada pedaco e
+ * copiado em bloco para um buffer, e as copias invertidas sao lacos simples
+ * sem dependencia entre iteracoes, que o compilador vetoriza.
+ */
+static void trocarTrecho(Peca *q, Peca *s, int n) {
+    Peca tmp[TAM_BLOCO_TROCA];
+    while (n > 0) {
+        int m = n < TAM_BLOCO_TROCA ? n : TAM_BLOCO_TROCA;
+        memcpy(tmp, q, (size_t) m * sizeof(Peca));
+        for (int i = 0; i < m; i++) q[i] = s[-i];
+        for (int i = 0; i < m; i++) s[-i] = tmp[i];
+        q += m;
+        s -= m;
+        n -= m;
     }
+}
+
+/*
+ * trocarBloco() – troca as k primeiras pecas da fila com as k pecas do topo da
+ * pilha: a frente da fila passa a ser o antigo topo, a segunda peca da fila o
+ * elemento abaixo do topo, e assim por diante (e vice-versa).
+ * O trecho da fila e dividido em no maximo dois segmentos contiguos no ponto
+ * em que o buffer circular da a volta.
+ * Retorna 1 se a troca foi feita, 0 se faltam pecas em alguma das estruturas.
+ */
+int trocarBloco(Fila *fila, Pilha *pilha, int k) {
+    if (k < 1 || filaQuantidade(fila) < k || pilha->topo + 1 < k) return 0;
 
-    int frente = fila->frente;
-    int topo = pilha->topo;
+    unsigned tamanho = fila->mascara + 1;
+    unsigned inicio = atomic_load_explicit(&fila->frente, memory_order_relaxed) & fila->mascara;
+    int primeiro = (int) (tamanho - inicio) < k ? (int) (tamanho - inicio) : k;
 
-    Peca temp = fila->pecas[frente];
-    fila->pecas[frente] = pilha->pecas[topo];
-    pilha->pecas[topo] = temp;
+    trocarTrecho(&fila->pecas[inicio], &pilha->pecas[pilha->topo], primeiro);
+    if (primeiro < k)
+        trocarTrecho(&fila->pecas[0], &pilha->pecas[pilha->topo - primeiro], k - primeiro);
+    return 1;
+}
 
-    printf("Troca realizada entre a frente da fila e o topo da pilha!\n");
+// Troca simples entre o topo da pilha e a frente da fila
+// Retorna 1 se a troca foi feita, 0 caso contrario
+int trocarTopoComFrente(Fila *fila, Pilha *pilha) {
+    INSTR_INICIO(OP_TROCA);
+    int ok = trocarBloco(fila, pilha, 1);
+    INSTR_FIM(OP_TROCA);
+    if (!ok) {
+        mensagem("Nao e possivel trocar. Uma das estruturas esta vazia.\n");
+        return 0;
+    }
+    mensagem("Troca realizada entre a frente da fila e o topo da pilha!\n");
+    return 1;
 }
 
 // Troca múltipla (3 da fila <-> 3 da pilha)
-void trocaMultipla(Fila *fila, Pilha *pilha) {
-    if (fila->quantidade < 3 || pilha->topo < 2) {
-        printf("Nao e possivel realizar troca multipla (faltam pecas).\n");
-        return;
+// Retorna 1 se a troca foi feita, 0 caso contrario
+int trocaMultipla(Fila *fila, Pilha *pilha) {
+    INSTR_INICIO(OP_TROCA_MULTIPLA);
+    int ok = trocarBloco(fila, pilha, 3);
+    INSTR_FIM(OP_TROCA_MULTIPLA);
+    if (!ok) {
+        mensagem("Nao e possivel realizar troca multipla (faltam pecas).\n");
+        return 0;
     }
+    mensagem("Troca multipla entre as 3 primeiras pecas da fila e da pilha concluida!\n");
+    return 1;
+}
+
+// ---------------------- PRODUTOR DE PECAS ----------------------
+
+// Capacidade padrao do buffer entre a thread geradora e o jogo
+#define TAM_BUFFER_PRODUTOR 1024
+
+// Pecas geradas por chamada a gerarPecas na thread geradora
+#define LOTE_PRODUTOR 64
 
-    for (int i = 0; i < 3; i++) {
-        int idxFila = (fila->frente + i) % TAM_FILA;
-        int idxPilha = pilha->topo - i;
+/*
+ * Thread que gera pecas antecipadamente com gerarPecas e as publica numa Fila
+ * SPSC; o laco do jogo e o unico consumidor. Os ids sao atribuidos em ordem
+ * pela propria thread, portanto a sequencia de pecas e a mesma do modo sem
+ * produtor.
+ */
+typedef struct {
+    Fila buffer;
+    pthread_t thread;
+    atomic_int ativo;
+    int proximoId;
+    Gerador gerador;
+} Produtor;
 
-        Peca temp = fila->pecas[idxFila];
-        fila->pecas[idxFila] = pilha->pecas[idxPilha];
-        pilha->pecas[idxPilha] = temp;
+static void* lacoProdutor(void *arg) {
+    Produtor *pr = (Produtor*) arg;
+    Peca lote[LOTE_PRODUTOR];
+    int n = 0, usados = 0;
+    while (atomic_load_explicit(&pr->ativo, memory_order_relaxed)) {
+        if (usados == n) {
+            gerarPecas(&pr->gerador, lote, LOTE_PRODUTOR, pr->proximoId);
+            pr->proximoId += LOTE_PRODUTOR;
+            n = LOTE_PRODUTOR;
+            usados = 0;
+        }
+        if (filaCheia(&pr->buffer)) {
+            sched_yield();
+            continue;
+        }
+        enfileirar(&pr->buffer, lote[usados++]);
     }
+    INSTR_DESCARREGAR();
+    return NULL;
+}
 
-    printf("Troca multipla entre as 3 primeiras pecas da fila e da pilha concluida!\n");
+// Inicia a thread geradora; retorna 0 em caso de sucesso
+int iniciarProdutor(Produtor *pr, int capacidade, int primeiroId, const Gerador *g) {
+    inicializarFila(&pr->buffer, capacidade);
+    pr->proximoId = primeiroId;
+    pr->gerador = *g;
+    atomic_init(&pr->ativo, 1);
+    if (pthread_create(&pr->thread, NULL, lacoProdutor, pr) != 0) {
+        liberarFila(&pr->buffer);
+        return -1;
+    }
+    return 0;
 }
 
-// ---------------------- MAIN ----------------------
-int main() {
-    srand(time(NULL));
+// Encerra a thread geradora e libera o buffer
+void pararProdutor(Produtor *pr) {
+    atomic_store(&pr->ativo, 0);
+    pthread_join(pr->thread, NULL);
+    liberarFila(&pr->buffer);
+}
 
-    Fila fila;
-    Pilha pilha;
-    inicializarFila(&fila);
-    inicializarPilha(&pilha);
+// ---------------------- DIARIO DE EVENTOS ----------------------
+/*
+ * Diario binario compacto de uma partida, para reproduzi-la exatamente.
+ *
+ * Cabecalho (32 bytes): "TSD1", modo do gerador, 3 bytes reservados,
+ * semente (u64), capacidade da fila (u32), da pilha (u32) e intervalo entre
+ * instantaneos (u32), em little-endian, mais 4 bytes reservados.
+ *
+ * Registros (os 2 bits baixos do primeiro byte indicam o tipo):
+ *  - acao:        (acao << 2) | 0; na troca em bloco (6) segue varint k
+ *  - peca gerada: 1 | (tipo << 2) | (delta << 4), onde tipo tem 2 bits e
+ *                 delta = id - (id anterior + 1); se delta >= 15 o campo
+ *                 vale 15 e o delta segue como varint. Normalmente 1 byte.
+ *  - instantaneo: 2, varint turno, varint proximo id, varint quantidade da
+ *                 fila e cada peca como varint((id << 2) | tipo), o mesmo
+ *                 para a pilha (base -> topo).
+ *  - indice:      3, u32 quantidade e pares (u64 turno, u64 deslocamento) dos
+ *                 instantaneos; o arquivo termina com u64 deslocamento do
+ *                 indice e "TSDI". Se faltar (arquivo truncado), o leitor
+ *                 reconstroi o indice percorrendo os registros.
+ *
+ * Um instantaneo de turno T guarda o estado apos T acoes e e gravado antes do
+ * registro da acao T. Ele e escrito no inicio (anexarDiario) e a cada
+ * 'intervalo' turnos.
+ */
+#define DIARIO_MAGICO "TSD1"
+#define DIARIO_MAGICO_INDICE "TSDI"
+#define DIARIO_TAM_CABECALHO 32
+#define DIARIO_TAM_BUFFER (1 << 16)
+#define DIARIO_INTERVALO_PADRAO 1024
+
+enum {
+    REG_ACAO = 0,
+    REG_PECA = 1,
+    REG_INSTANTANEO = 2,
+    REG_INDICE = 3
+};
+
+typedef struct {
+    uint64_t turno;
+    uint64_t deslocamento;
+} EntradaIndice;
+
+typedef struct {
+    // gravacao
+    FILE *arquivo;
+    unsigned char *buffer;
+    size_t usado;
+    uint64_t descarregado;   // bytes ja enviados ao arquivo
+
+    // leitura (arquivo mapeado em memoria)
+    const unsigned char *dados;
+    size_t tamanho;          // tamanho do mapeamento
+    size_t fim;              // fim dos registros (inicio do indice)
+    size_t pos;
 
-    int idCounter = 0;
+    // comum
+    uint64_t semente;
+    int modoGerador;
+    int capFila;
+    int capPilha;
+    int intervalo;
+    uint64_t turno;
+    int ultimoId;            // id da ultima peca registrada/lida
+    EntradaIndice *indice;
+    size_t numIndice;
+    size_t capIndice;
+} Diario;
 
-    // Inicializa a fila com 5 peças
-    for (int i = 0; i < TAM_FILA; i++) {
-        enfileirar(&fila, gerarPeca(idCounter++));
+static void diarioAdicionarIndice(Diario *d, uint64_t turno, uint64_t deslocamento) {
+    if (d->numIndice == d->capIndice) {
+        d->capIndice = d->capIndice ? d->capIndice * 2 : 64;
+        EntradaIndice *novo = (EntradaIndice*) realloc(d->indice, d->capIndice * sizeof(EntradaIndice));
+        if (!novo) {
+            fprintf(stderr, "Erro: falha na alocacao do indice do diario\n");
+            exit(1);
+        }
+        d->indice = novo;
     }
+    d->indice[d->numIndice].turno = turno;
+    d->indice[d->numIndice].deslocamento = deslocamento;
+    d->numIndice++;
+}
 
-    int opcao;
-    do {
-        exibirEstado(&fila, &pilha);
-        printf("\nOpcoes disponiveis:\n");
-        printf("1 - Jogar peca (remover da fila)\n");
-        printf("2 - Reservar peca (mover para pilha)\n");
-        printf("3 - Usar peca reservada (remover do topo da pilha)\n");
-        printf("4 - Trocar peca da frente com o topo da pilha\n");
-        printf("5 - Trocar as 3 primeiras da fila com as 3 da pilha\n");
-        printf("0 - Sair\n");
-        printf("Opcao: ");
-        scanf("%d", &opcao);
-
-        switch (opcao) {
-            case 1: { // Jogar peça
-                if (!filaVazia(&fila)) {
-                    Peca jogada = desenfileirar(&fila);
-                    printf("Peca [%c %d] jogada!\n", jogada.tipo, jogada.id);
-                    enfileirar(&fila, gerarPeca(idCounter++));
-                } else {
-                    printf("Fila vazia!\n");
-                }
-                break;
-            }
-            case 2: { // Reservar peça
-                if (pilhaCheia(&pilha)) {
-                    printf("Pilha cheia! Nao e possivel reservar mais pecas.\n");
-                } else if (!filaVazia(&fila)) {
-                    Peca reservada = desenfileirar(&fila);
-                    empilhar(&pilha, reservada);
-                    printf("Peca [%c %d] movida para a reserva!\n", reservada.tipo, reservada.id);
-                    enfileirar(&fila, gerarPeca(idCounter++));
-                }
-                break;
-            }
-            case 3: { // Usar peça da reserva
-                if (!pilhaVazia(&pilha)) {
-                    Peca usada = desempilhar(&pilha);
-                    printf("Peca reservada [%c %d] usada!\n", usada.tipo, usada.id);
-                } else {
-                    printf("Pilha de reserva vazia!\n");
+// ---- escrita ----
+
+static void diarioDescarregar(Diario *d) {
+    if (d->usado == 0) return;
+    fwrite(d->buffer, 1, d->usado, d->arquivo);
+    d->descarregado += d->usado;
+    d->usado = 0;
+}
+
+// Garante espaco para n bytes no buffer
+static unsigned char* diarioReservar(Diario *d, size_t n) {
+    if (d->usado + n > DIARIO_TAM_BUFFER) diarioDescarregar(d);
+    return d->buffer + d->usado;
+}
+
+static void diarioByte(Diario *d, unsigned char b) {
+    *diarioReservar(d, 1) = b;
+    d->usado++;
+}
+
+static void diarioVarint(Diario *d, uint64_t v) {
+    unsigned char *p = diarioReservar(d, 10);
+    size_t n = 0;
+    while (v >= 0x80) {
+        p[n++] = (unsigned char) (v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (unsigned char) v;
+    d->usado += n;
+}
+
+static void diarioInteiro(Diario *d, uint64_t v, int bytes) {
+    unsigned char *p = diarioReservar(d, (size_t) bytes);
+    for (int i = 0; i < bytes; i++) p[i] = (unsigned char) (v >> (8 * i));
+    d->usado += (size_t) bytes;
+}
+
+// Cria o arquivo do diario e grava o cabecalho; retorna 0 em caso de sucesso
+int diarioAbrir(Diario *d, const char *caminho, const Gerador *g,
+                int capFila, int capPilha, int intervalo) {
+    memset(d, 0, sizeof(*d));
+    d->arquivo = fopen(caminho, "wb");
+    if (!d->arquivo) return -1;
+    d->buffer = (unsigned char*) malloc(DIARIO_TAM_BUFFER);
+    if (!d->buffer) {
+        fclose(d->arquivo);
+        return -1;
+    }
+    d->semente = g->semente;
+    d->modoGerador = (int) g->modo;
+    d->capFila = capFila;
+    d->capPilha = capPilha;
+    d->intervalo = intervalo > 0 ? intervalo : DIARIO_INTERVALO_PADRAO;
+    d->ultimoId = -1;
+
+    memcpy(diarioReservar(d, 4), DIARIO_MAGICO, 4);
+    d->usado += 4;
+    diarioInteiro(d, (uint64_t) d->modoGerador, 4);
+    diarioInteiro(d, d->semente, 8);
+    diarioInteiro(d, (uint64_t) capFila, 4);
+    diarioInteiro(d, (uint64_t) capPilha, 4);
+    diarioInteiro(d, (uint64_t) d->intervalo, 4);
+    diarioInteiro(d, 0, 4);
+    return 0;
+}
+
+// Peca no formato compacto dos instantaneos
+static void diarioPecaAbsoluta(Diario *d, Peca p) {
+    diarioVarint(d, ((uint64_t) p.id << 2) | (uint64_t) tipoIndice(p.tipo));
+}
+
+// Grava um instantaneo completo da fila e da pilha
+void diarioInstantaneo(Diario *d, Fila *f, Pilha *p, int idCounter) {
+    diarioAdicionarIndice(d, d->turno, d->descarregado + d->usado);
+    diarioByte(d, REG_INSTANTANEO);
+    diarioVarint(d, d->turno);
+    diarioVarint(d, (uint64_t) idCounter);
+    int quantidade = filaQuantidade(f);
+    diarioVarint(d, (uint64_t) quantidade);
+    for (int i = 0; i < quantidade; i++) diarioPecaAbsoluta(d, *filaPosicao(f, i));
+    diarioVarint(d, (uint64_t) (p->topo + 1));
+    for (int i = 0; i <= p->topo; i++) diarioPecaAbsoluta(d, p->pecas[i]);
+    d->ultimoId = idCounter - 1;
+}
+
+// Registra uma acao (e, quando for o caso, o instantaneo que a precede)
+void diarioAcao(Diario *d, Fila *f, Pilha *p, int idCounter, int acao, int k) {
+    if (d->turno > 0 && d->turno % (uint64_t) d->intervalo == 0)
+        diarioInstantaneo(d, f, p, idCounter);
+    if (acao < 0 || acao > 63) acao = 63; // opcao invalida
+    diarioByte(d, (unsigned char) (acao << 2) | REG_ACAO);
+    if (acao == 6) diarioVarint(d, (uint64_t) (k > 0 ? k : 0));
+    d->turno++;
+}
+
+// Registra uma peca gerada
+void diarioPeca(Diario *d, Peca p) {
+    uint64_t delta = (uint64_t) ((int64_t) p.id - (int64_t) d->ultimoId - 1);
+    unsigned char b = (unsigned char) (REG_PECA | (tipoIndice(p.tipo) << 2));
+    if (delta < 15) {
+        diarioByte(d, (unsigned char) (b | (delta << 4)));
+    } else {
+        diarioByte(d, (unsigned char) (b | (15 << 4)));
+        diarioVarint(d, delta);
+    }
+    d->ultimoId = p.id;
+}
+
+// Grava o indice de instantaneos e fecha o arquivo
+void diarioFechar(Diario *d) {
+    uint64_t posIndice = d->descarregado + d->usado;
+    diarioByte(d, REG_INDICE);
+    diarioInteiro(d, (uint64_t) d->numIndice, 4);
+    for (size_t i = 0; i < d->numIndice; i++) {
+        diarioInteiro(d, d->indice[i].turno, 8);
+        diarioInteiro(d, d->indice[i].deslocamento, 8);
+    }
+    diarioInteiro(d, posIndice, 8);
+    memcpy(diarioReservar(d, 4), DIARIO_MAGICO_INDICE, 4);
+    d->usado += 4;
+    diarioDescarregar(d);
+    fclose(d->arquivo);
+    free(d->buffer);
+    free(d->indice);
+    d->arquivo = NULL;
+    d->buffer = NULL;
+    d->indice = NULL;
+}
+
+// ---- leitura ----
+
+// Mapeia o arquivo inteiro em memoria (somente leitura); NULL em caso de erro
+const unsigned char* mapearArquivo(const char *caminho, size_t *tamanho) {
+#ifdef _WIN32
+    FILE *arq = fopen(caminho, "rb");
+    if (!arq) return NULL;
+    fseek(arq, 0, SEEK_END);
+    long tam = ftell(arq);
+    fseek(arq, 0, SEEK_SET);
+    unsigned char *dados = (unsigned char*) malloc(tam > 0 ? (size_t) tam : 1);
+    if (!dados || fread(dados, 1, (size_t) tam, arq) != (size_t) tam) {
+        free(dados);
+        fclose(arq);
+        return NULL;
+    }
+    fclose(arq);
+    *tamanho = (size_t) tam;
+    return dados;
+#else
+    int fd = open(caminho, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return NULL;
+    }
+    void *dados = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (dados == MAP_FAILED) return NULL;
+    *tamanho = (size_t) st.st_size;
+    return (const unsigned char*) dados;
+#endif
+}
+
+void desmapearArquivo(const unsigned char *dados, size_t tamanho) {
+#ifdef _WIN32
+    (void) tamanho;
+    free((void*) dados);
+#else
+    munmap((void*) dados, tamanho);
+#endif
+}
+
+static uint64_t lerInteiro(const unsigned char *p, int bytes) {
+    uint64_t v = 0;
+    for (int i = 0; i < bytes; i++) v |= (uint64_t) p[i] << (8 * i);
+    return v;
+}
+
+// Le um varint; em caso de fim de arquivo devolve 0 e posiciona no fim
+static uint64_t diarioLerVarint(Diario *d) {
+    uint64_t v = 0;
+    int desloc = 0;
+    while (d->pos < d->fim && desloc < 64) {
+        unsigned char b = d->dados[d->pos++];
+        v |= (uint64_t) (b & 0x7F) << desloc;
+        if (!(b & 0x80)) return v;
+        desloc += 7;
+    }
+    d->pos = d->fim;
+    return 0;
+}
+
+static Peca diarioLerPecaAbsoluta(Diario *d) {
+    uint64_t v = diarioLerVarint(d);
+    Peca p;
+    p.tipo = TIPOS_PECA[v & 3];
+    p.id = (int) (v >> 2);
+    return p;
+}
+
+// Le o corpo de um registro de peca cujo primeiro byte e b
+static Peca diarioLerPecaRelativa(Diario *d, unsigned char b) {
+    uint64_t delta = b >> 4;
+    if (delta == 15) delta = diarioLerVarint(d);
+    Peca p;
+    p.tipo = TIPOS_PECA[(b >> 2) & 3];
+    p.id = (int) ((int64_t) d->ultimoId + 1 + (int64_t) delta);
+    d->ultimoId = p.id;
+    return p;
+}
+
+// Carrega um instantaneo (d->pos logo apos o byte de tipo) na fila e na pilha
+static void diarioLerInstantaneo(Diario *d, Fila *f, Pilha *p, int *idCounter) {
+    d->turno = diarioLerVarint(d);
+    int proximo = (int) diarioLerVarint(d);
+    int quantidade = (int) diarioLerVarint(d);
+    if (f) {
+        atomic_store(&f->frente, 0);
+        atomic_store(&f->tras, 0);
+        f->frenteCache = f->trasCache = 0;
+        p->topo = -1;
+    }
+    for (int i = 0; i < quantidade; i++) {
+        Peca pc = diarioLerPecaAbsoluta(d);
+        if (f) enfileirar(f, pc);
+    }
+    int naPilha = (int) diarioLerVarint(d);
+    for (int i = 0; i < naPilha; i++) {
+        Peca pc = diarioLerPecaAbsoluta(d);
+        if (f) empilhar(p, pc);
+    }
+    if (idCounter) *idCounter = proximo;
+    d->ultimoId = proximo - 1;
+}
+
+/*
+ * Avanca um registro. Devolve o tipo lido (ou -1 no fim dos registros);
+ * em 'acao'/'k' ficam os campos de um registro de acao. Pecas e
+ * instantaneos sao apenas pulados.
+ */
+static int diarioPularRegistro(Diario *d, int *acao, int *k) {
+    if (d->pos >= d->fim) return -1;
+    unsigned char b = d->dados[d->pos++];
+    switch (b & 3) {
+        case REG_ACAO:
+            *acao = b >> 2;
+            *k = *acao == 6 ? (int) diarioLerVarint(d) : 0;
+            return REG_ACAO;
+        case REG_PECA:
+            diarioLerPecaRelativa(d, b);
+            return REG_PECA;
+        case REG_INSTANTANEO:
+            diarioLerInstantaneo(d, NULL, NULL, NULL);
+            return REG_INSTANTANEO;
+        default:
+            d->pos = d->fim;
+            return -1;
+    }
+}
+
+void diarioFecharLeitura(Diario *d);
+
+// Abre um diario para leitura: mapeia o arquivo e carrega (ou reconstroi) o indice
+int diarioAbrirLeitura(Diario *d, const char *caminho) {
+    memset(d, 0, sizeof(*d));
+    d->dados = mapearArquivo(caminho, &d->tamanho);
+    if (!d->dados) return -1;
+    if (d->tamanho < DIARIO_TAM_CABECALHO || memcmp(d->dados, DIARIO_MAGICO, 4) != 0) {
+        desmapearArquivo(d->dados, d->tamanho);
+        return -1;
+    }
+    d->modoGerador = (int) lerInteiro(d->dados + 4, 4);
+    d->semente = lerInteiro(d->dados + 8, 8);
+    d->capFila = (int) lerInteiro(d->dados + 16, 4);
+    d->capPilha = (int) lerInteiro(d->dados + 20, 4);
+    d->intervalo = (int) lerInteiro(d->dados + 24, 4);
+
+    // indice gravado no fim do arquivo
+    size_t fimRegistros = d->tamanho;
+    if (d->tamanho >= DIARIO_TAM_CABECALHO + 12 &&
+        memcmp(d->dados + d->tamanho - 4, DIARIO_MAGICO_INDICE, 4) == 0) {
+        uint64_t posIndice = lerInteiro(d->dados + d->tamanho - 12, 8);
+        if (posIndice + 5 <= d->tamanho && d->dados[posIndice] == REG_INDICE) {
+            size_t n = (size_t) lerInteiro(d->dados + posIndice + 1, 4);
+            if (posIndice + 5 + n * 16 + 12 == d->tamanho) {
+                for (size_t i = 0; i < n; i++) {
+                    const unsigned char *e = d->dados + posIndice + 5 + i * 16;
+                    diarioAdicionarIndice(d, lerInteiro(e, 8), lerInteiro(e + 8, 8));
                 }
-                break;
+                fimRegistros = (size_t) posIndice;
             }
-            case 4: // Troca simples
-                trocarTopoComFrente(&fila, &pilha);
-                break;
+        }
+    }
 
-            case 5: // Troca múltipla
-                trocaMultipla(&fila, &pilha);
-                break;
+    if (fimRegistros == d->tamanho) {
+        // sem indice valido: percorre os registros uma vez
+        d->fim = d->tamanho;
+        d->pos = DIARIO_TAM_CABECALHO;
+        int acao, k;
+        for (;;) {
+            size_t inicio = d->pos;
+            if (inicio < d->fim && (d->dados[inicio] & 3) == REG_INDICE) break;
+            int tipo = diarioPularRegistro(d, &acao, &k);
+            if (tipo < 0) break;
+            if (tipo == REG_INSTANTANEO) diarioAdicionarIndice(d, d->turno, inicio);
+        }
+        fimRegistros = d->pos;
+    }
+    d->fim = fimRegistros;
+    if (d->numIndice == 0) {
+        diarioFecharLeitura(d);
+        return -1;
+    }
+    return 0;
+}
 
-            case 0:
-                printf("Encerrando o programa...\n");
-                break;
+// Proxima peca registrada (usada pela reproducao no lugar do gerador)
+Peca diarioLerPeca(Diario *d) {
+    Peca vazia = {'-', -1};
+    while (d->pos < d->fim) {
+        unsigned char b = d->dados[d->pos];
+        if ((b & 3) != REG_PECA) {
+            if ((b & 3) != REG_INSTANTANEO) return vazia;
+            d->pos++;
+            diarioLerInstantaneo(d, NULL, NULL, NULL);
+            continue;
+        }
+        d->pos++;
+        return diarioLerPecaRelativa(d, b);
+    }
+    return vazia;
+}
 
-            default:
-                printf("Opcao invalida!\n");
+void diarioFecharLeitura(Diario *d) {
+    if (d->dados) desmapearArquivo(d->dados, d->tamanho);
+    free(d->indice);
+    d->dados = NULL;
+    d->indice = NULL;
+}
+
+// ---------------------- ESTADO DO JOGO ----------------------
+
+// Agrupa as estruturas de uma partida (usado pelo modo interativo e pelo modo em lote)
+typedef struct {
+    Fila fila;
+    Pilha pilha;
+    int idCounter;       // id da proxima peca
+    Gerador gerador;
+    Produtor *produtor;  // se nao for NULL, as pecas vem da thread geradora
+    Diario *diario;      // se nao for NULL, acoes e pecas sao gravadas
+    Diario *reproducao;  // se nao for NULL, as pecas vem de um diario gravado
+    int ultimoTipo;      // indice do tipo da ultima peca jogada (NUM_TIPOS = nenhuma)
+    long pontos;
+} Jogo;
+
+// Obtem a proxima peca: do diario em reproducao, do produtor (aguardando se
+// necessario) ou de gerarPeca
+Peca proximaPeca(Jogo *j) {
+    Peca p;
+    if (j->reproducao) {
+        p = diarioLerPeca(j->reproducao);
+        j->idCounter = p.id + 1;
+    } else if (!j->produtor) {
+        p = gerarPeca(&j->gerador, j->idCounter++);
+    } else {
+        p = desenfileirar(&j->produtor->buffer);
+        while (p.id < 0) {
+            sched_yield();
+            p = desenfileirar(&j->produtor->buffer);
         }
+        j->idCounter = p.id + 1;
+    }
+    if (j->diario) diarioPeca(j->diario, p);
+    return p;
+}
 
-    } while (opcao != 0);
+// Inicializa a partida com a fila cheia
+void inicializarJogo(Jogo *j, int capacidadeFila, int capacidadePilha,
+                     const Gerador *g, Produtor *produtor) {
+    inicializarFila(&j->fila, capacidadeFila);
+    inicializarPilha(&j->pilha, capacidadePilha);
+    j->idCounter = 0;
+    j->gerador = *g;
+    j->produtor = produtor;
+    j->diario = NULL;
+    j->reproducao = NULL;
+    j->ultimoTipo = NUM_TIPOS;
+    j->pontos = 0;
 
-    return 0;
-}
\ No newline at end of file
+    // Inicializa a fila com 'capacidadeFila' peças
+    for (int i = 0; i < capacidadeFila; i++) {
+        enfileirar(&j->fila, proximaPeca(j));
+    }
+}
+
+// Passa a gravar a partida em 'd', a partir de um instantaneo do estado atual
+void anexarDiario(Jogo *j, Diario *d) {
+    j->diario = d;
+    if (d) diarioInstantaneo(d, &j->fila, &j->pilha, j->idCounter);
+}
+
+// Libera os recursos da partida
+void liberarJogo(Jogo *j) {
+    liberarFila(&j->fila);
+    liberarPilha(&j->pilha);
+}
+
+// Executa uma opcao do menu (1 a 5) sobre a partida.
+// Retorna 1 se a acao teve efeito, 0 caso tenha sido recusada.
+int executarAcao(Jogo *j, int opcao) {
+    if (j->diario) diarioAcao(j->diario, &j->fila, &j->pilha, j->idCounter, opcao, 0);
+
+    switch (opcao) {
+        case 1: { // Jogar peça
+            if (!filaVazia(&j->fila)) {
+                Peca jogada = desenfileirar(&j->fila);
+                j->pontos += pontuarJogada(jogada.tipo, &j->ultimoTipo);
+                mensagem("Peca [%c %d] jogada!\n", jogada.tipo, jogada.id);
+                enfileirar(&j->fila, proximaPeca(j));
+                return 1;
+            }
+            mensagem("Fila vazia!\n");
+            return 0;
+        }
+        case 2: { // Reservar peça
+            if (pilhaCheia(&j->pilha)) {
+                mensagem("Pilha cheia! Nao e possivel reservar mais pecas.\n");
+            } else if (!filaVazia(&j->fila)) {
+                Peca reservada = desenfileirar(&j->fila);
+                empilhar(&j->pilha, reservada);
+                mensagem("Peca [%c %d] movida para a reserva!\n", reservada.tipo, reservada.id);
+                enfileirar(&j->fila, proximaPeca(j));
+                return 1;
+            }
+            return 0;
+        }
+        case 3: { // Usar peça da reserva
+            if (!pilhaVazia(&j->pilha)) {
+                Peca usada = desempilhar(&j->pilha);
+                j->pontos += pontuarJogada(usada.tipo, &j->ultimoTipo);
+                mensagem("Peca reservada [%c %d] usada!\n", usada.tipo, usada.id);
+                return 1;
+            }
+            mensagem("Pilha de reserva vazia!\n");
+            return 0;
+        }
+        case 4: // Troca simples
+            return trocarTopoComFrente(&j->fila, &j->pilha);
+
+        case 5: // Troca múltipla
+            return trocaMultipla(&j->fila, &j->pilha);
+
+        default:
+            mensagem("Opcao invalida!\n");
+            return 0;
+    }
+}
+
+// Troca em bloco de k pecas (opcao 6 do menu), com registro no diario
+int executarTrocaBloco(Jogo *j, int k) {
+    if (j->diario) diarioAcao(j->diario, &j->fila, &j->pilha, j->idCounter, 6, k);
+
+    if (trocarBloco(&j->fila, &j->pilha, k)) {
+        mensagem("Troca em bloco de %d pecas entre a fila e a pilha concluida!\n", k);
+        return 1;
+    }
+    mensagem("Nao e possivel trocar %d pecas (faltam pecas).\n", k);
+    return 0;
+}
+
+// ---------------------- BUSCA DE JOGADAS ----------------------
+/*
+ * Busca em profundidade limitada que escolhe, entre as opcoes 1 a 5, a que
+ * maximiza a pontuacao (pontuarJogada) nas proximas jogadas. Como o tipo de
+ * cada peca depende so de (semente, id), as pecas que vao repor a fila sao
+ * conhecidas e a busca e exata.
+ *
+ * Estados repetidos sao reconhecidos por hash de Zobrist: uma chave por
+ * (posicao no buffer da fila, tipo), por (posicao na pilha, tipo) e pelo
+ * tipo da ultima peca usada, mais uma mistura do proximo id. Cada acao so
+ * troca as chaves das posicoes que mudaram. A frente da fila nao entra no
+ * hash porque avanca junto com o proximo id (toda remocao e seguida de uma
+ * reposicao). Os ids das pecas tambem nao entram: dois estados que diferem
+ * so nos ids tem o mesmo futuro.
+ *
+ * Os estados avaliados ficam numa tabela de transposicao de tamanho fixo,
+ * compartilhada sem travas: cada entrada guarda (chave ^ dados, dados), e
+ * uma leitura so e aceita se os dois campos forem coerentes.
+ * As opcoes da raiz sao divididas entre threads.
+ */
+#define PROF_MAX 16
+#define TT_BITS_PADRAO 20
+
+typedef struct {
+    uint64_t *fila;      // (mascara + 1) * NUM_TIPOS
+    uint64_t *pilha;     // capPilha * NUM_TIPOS
+    uint64_t ultimo[NUM_TIPOS + 1];
+    unsigned mascara;
+    int capPilha;
+} Zobrist;
+
+typedef struct {
+    _Atomic uint64_t chaveXor;
+    _Atomic uint64_t dados;  // valor (32 bits) | profundidade (8) | acao (8)
+} EntradaTT;
+
+typedef struct {
+    EntradaTT *entradas;
+    uint64_t mascara;
+} TabelaTransposicao;
+
+typedef struct {
+    int acao;            // melhor opcao (0 se nenhuma e possivel)
+    long valor;          // pontuacao esperada nas proximas 'profundidade' jogadas
+    long nos;
+    long acertosTT;
+} Dica;
+
+void inicializarZobrist(Zobrist *z, const Fila *f, const Pilha *p) {
+    z->mascara = f->mascara;
+    z->capPilha = p->capacidade;
+    size_t nFila = (size_t) (f->mascara + 1) * NUM_TIPOS;
+    size_t nPilha = (size_t) p->capacidade * NUM_TIPOS;
+    z->fila = (uint64_t*) malloc(nFila * sizeof(uint64_t));
+    z->pilha = (uint64_t*) malloc(nPilha * sizeof(uint64_t));
+    if (!z->fila || !z->pilha) {
+        fprintf(stderr, "Erro: falha na alocacao das chaves de Zobrist\n");
+        exit(1);
+    }
+    uint64_t x = 0x5A0B1157ULL;
+    for (size_t i = 0; i < nFila; i++) z->fila[i] = x = misturar64(x);
+    for (size_t i = 0; i < nPilha; i++) z->pilha[i] = x = misturar64(x);
+    for (int i = 0; i <= NUM_TIPOS; i++) z->ultimo[i] = x = misturar64(x);
+}
+
+void liberarZobrist(Zobrist *z) {
+    free(z->fila);
+    free(z->pilha);
+}
+
+static inline uint64_t zobristId(int id) {
+    return misturar64((uint64_t) id ^ 0x1D1D1D1DULL);
+}
+
+static inline uint64_t zobristFila(const Zobrist *z, unsigned slot, char tipo) {
+    return z->fila[(size_t) (slot & z->mascara) * NUM_TIPOS + (size_t) tipoIndice(tipo)];
+}
+
+static inline uint64_t zobristPilha(const Zobrist *z, int pos, char tipo) {
+    return z->pilha[(size_t) pos * NUM_TIPOS + (size_t) tipoIndice(tipo)];
+}
+
+// Hash completo de um estado (usado so na raiz; depois e atualizado por acao)
+uint64_t hashEstado(const Zobrist *z, Fila *f, Pilha *p, int idCounter, int ultimoTipo) {
+    uint64_t h = zobristId(idCounter) ^ z->ultimo[ultimoTipo];
+    unsigned frente = atomic_load_explicit(&f->frente, memory_order_relaxed);
+    int quantidade = filaQuantidade(f);
+    for (int i = 0; i < quantidade; i++)
+        h ^= zobristFila(z, frente + (unsigned) i, filaPosicao(f, i)->tipo);
+    for (int i = 0; i <= p->topo; i++)
+        h ^= zobristPilha(z, i, p->pecas[i].tipo);
+    return h;
+}
+
+void inicializarTT(TabelaTransposicao *tt, int bits) {
+    size_t n = (size_t) 1 << bits;
+    tt->entradas = (EntradaTT*) calloc(n, sizeof(EntradaTT));
+    if (!tt->entradas) {
+        fprintf(stderr, "Erro: falha na alocacao da tabela de transposicao\n");
+        exit(1);
+    }
+    tt->mascara = n - 1;
+}
+
+void liberarTT(TabelaTransposicao *tt) {
+    free(tt->entradas);
+}
+
+static int consultarTT(TabelaTransposicao *tt, uint64_t h, int prof, long *valor) {
+    EntradaTT *e = &tt->entradas[h & tt->mascara];
+    uint64_t dados = atomic_load_explicit(&e->dados, memory_order_relaxed);
+    uint64_t chaveXor = atomic_load_explicit(&e->chaveXor, memory_order_relaxed);
+    if ((chaveXor ^ dados) != h || dados == 0) return 0;
+    if ((int) ((dados >> 8) & 0xFF) != prof) return 0; // o valor depende da profundidade
+    *valor = (long) (uint32_t) (dados >> 16);
+    return 1;
+}
+
+static void gravarTT(TabelaTransposicao *tt, uint64_t h, int prof, long valor, int acao) {
+    EntradaTT *e = &tt->entradas[h & tt->mascara];
+    uint64_t dados = ((uint64_t) (uint32_t) valor << 16) | ((uint64_t) prof << 8) | (uint64_t) acao;
+    atomic_store_explicit(&e->dados, dados, memory_order_relaxed);
+    atomic_store_explicit(&e->chaveXor, h ^ dados, memory_order_relaxed);
+}
+
+// Copia o conteudo de src para dst (mesmas capacidades); uso exclusivo da busca
+static void copiarFila(Fila *dst, Fila *src) {
+    memcpy(dst->pecas, src->pecas, (size_t) (src->mascara + 1) * sizeof(Peca));
+    unsigned frente = atomic_load_explicit(&src->frente, memory_order_relaxed);
+    unsigned tras = atomic_load_explicit(&src->tras, memory_order_relaxed);
+    atomic_store_explicit(&dst->frente, frente, memory_order_relaxed);
+    atomic_store_explicit(&dst->tras, tras, memory_order_relaxed);
+    dst->trasCache = tras;
+    dst->frenteCache = frente;
+}
+
+static void copiarPilha(Pilha *dst, const Pilha *src) {
+    memcpy(dst->pecas, src->pecas, (size_t) (src->topo + 1) * sizeof(Peca));
+    dst->topo = src->topo;
+}
+
+// Estado de uma thread de busca: uma copia de fila/pilha por nivel
+typedef struct {
+    Fila fila[PROF_MAX + 1];
+    Pilha pilha[PROF_MAX + 1];
+    const Zobrist *z;
+    TabelaTransposicao *tt;
+    Gerador gerador;
+    long nos;
+    long acertosTT;
+} Buscador;
+
+/*
+ * Aplica 'acao' ao estado (f, p) com as mesmas regras de executarAcao,
+ * atualizando o hash, o proximo id e o tipo da ultima peca usada.
+ * Retorna os pontos obtidos ou -1 se a acao nao e possivel.
+ */
+static int aplicarNaBusca(const Zobrist *z, const Gerador *g, Fila *f, Pilha *p, int acao,
+                          uint64_t *h, int *idCounter, int *ultimoTipo) {
+    int pontos = 0;
+    switch (acao) {
+        case 1:
+        case 2: {
+            if (filaVazia(f) || (acao == 2 && pilhaCheia(p))) return -1;
+            unsigned frente = atomic_load_explicit(&f->frente, memory_order_relaxed);
+            Peca saiu = desenfileirar(f);
+            *h ^= zobristFila(z, frente, saiu.tipo);
+            if (acao == 1) {
+                *h ^= z->ultimo[*ultimoTipo];
+                pontos = pontuarJogada(saiu.tipo, ultimoTipo);
+                *h ^= z->ultimo[*ultimoTipo];
+            } else {
+                empilhar(p, saiu);
+                *h ^= zobristPilha(z, p->topo, saiu.tipo);
+            }
+            unsigned tras = atomic_load_explicit(&f->tras, memory_order_relaxed);
+            Peca nova = gerarPeca(g, *idCounter);
+            enfileirar(f, nova);
+            *h ^= zobristFila(z, tras, nova.tipo) ^ zobristId(*idCounter) ^ zobristId(*idCounter + 1);
+            (*idCounter)++;
+            return pontos;
+        }
+        case 3: {
+            if (pilhaVazia(p)) return -1;
+            *h ^= zobristPilha(z, p->topo, p->pecas[p->topo].tipo);
+            Peca usada = desempilhar(p);
+            *h ^= z->ultimo[*ultimoTipo];
+            pontos = pontuarJogada(usada.tipo, ultimoTipo);
+            *h ^= z->ultimo[*ultimoTipo];
+            return pontos;
+        }
+        case 4:
+        case 5: {
+            int k = acao == 4 ? 1 : 3;
+            if (filaQuantidade(f) < k || p->topo + 1 < k) return -1;
+            unsigned frente = atomic_load_explicit(&f->frente, memory_order_relaxed);
+            for (int i = 0; i < k; i++) {
+                char tf = filaPosicao(f, i)->tipo, tp = p->pecas[p->topo - i].tipo;
+                *h ^= zobristFila(z, frente + (unsigned) i, tf) ^ zobristFila(z, frente + (unsigned) i, tp);
+                *h ^= zobristPilha(z, p->topo - i, tp) ^ zobristPilha(z, p->topo - i, tf);
+            }
+            trocarBloco(f, p, k);
+            return 0;
+        }
+        default:
+            return -1;
+    }
+}
+
+// Melhor pontuacao a partir do estado do nivel 'nivel' em 'prof' jogadas
+static long buscar(Buscador *b, int nivel, int prof, uint64_t h, int idCounter, int ultimoTipo) {
+    b->nos++;
+    if (prof == 0) return 0;
+
+    long valor;
+    if (consultarTT(b->tt, h, prof, &valor)) {
+        b->acertosTT++;
+        return valor;
+    }
+
+    long melhor = 0;
+    int melhorAcao = 0;
+    for (int acao = 1; acao <= 5; acao++) {
+        Fila *f = &b->fila[nivel + 1];
+        Pilha *p = &b->pilha[nivel + 1];
+        copiarFila(f, &b->fila[nivel]);
+        copiarPilha(p, &b->pilha[nivel]);
+        uint64_t h2 = h;
+        int id2 = idCounter, ultimo2 = ultimoTipo;
+        int pontos = aplicarNaBusca(b->z, &b->gerador, f, p, acao, &h2, &id2, &ultimo2);
+        if (pontos < 0) continue;
+        long v = pontos + buscar(b, nivel + 1, prof - 1, h2, id2, ultimo2);
+        if (!melhorAcao || v > melhor) {
+            melhor = v;
+            melhorAcao = acao;
+        }
+    }
+    gravarTT(b->tt, h, prof, melhor, melhorAcao);
+    return melhor;
+}
+
+// Trabalho de uma thread da raiz: avalia as opcoes a com (a - 1) % passo == primeira - 1
+typedef struct {
+    Buscador *b;
+    Jogo *jogo;
+    int primeira;
+    int passo;
+    int prof;
+    long valor[6];       // -1 = opcao impossivel
+} TrabalhoRaiz;
+
+static void* trabalhadorRaiz(void *arg) {
+    TrabalhoRaiz *t = (TrabalhoRaiz*) arg;
+    Buscador *b = t->b;
+    Jogo *j = t->jogo;
+    uint64_t h0 = hashEstado(b->z, &j->fila, &j->pilha, j->idCounter, j->ultimoTipo);
+    for (int acao = t->primeira; acao <= 5; acao += t->passo) {
+        copiarFila(&b->fila[0], &j->fila);
+        copiarPilha(&b->pilha[0], &j->pilha);
+        uint64_t h = h0;
+        int id = j->idCounter, ultimo = j->ultimoTipo;
+        int pontos = aplicarNaBusca(b->z, &b->gerador, &b->fila[0], &b->pilha[0], acao, &h, &id, &ultimo);
+        t->valor[acao] = pontos < 0 ? -1 : pontos + buscar(b, 0, t->prof - 1, h, id, ultimo);
+    }
+    INSTR_DESCARREGAR();
+    return NULL;
+}
+
+static Buscador* criarBuscador(Jogo *j, const Zobrist *z, TabelaTransposicao *tt) {
+    Buscador *b = (Buscador*) malloc(sizeof(Buscador));
+    if (!b) {
+        fprintf(stderr, "Erro: falha na alocacao do buscador\n");
+        exit(1);
+    }
+    for (int i = 0; i <= PROF_MAX; i++) {
+        inicializarFila(&b->fila[i], (int) j->fila.capacidade);
+        inicializarPilha(&b->pilha[i], j->pilha.capacidade);
+    }
+    b->z = z;
+    b->tt = tt;
+    b->gerador = j->gerador;
+    b->nos = b->acertosTT = 0;
+    return b;
+}
+
+static void liberarBuscador(Buscador *b) {
+    for (int i = 0; i <= PROF_MAX; i++) {
+        liberarFila(&b->fila[i]);
+        liberarPilha(&b->pilha[i]);
+    }
+    free(b);
+}
+
+/*
+ * Threads de busca da partida: criadas uma vez (com um Buscador cada) e
+ * reaproveitadas a cada dica; a thread que chama faz a parte da thread 0.
+ */
+#define BUSCA_MAX_THREADS 5   // uma por opcao da raiz
+
+typedef struct PoolBusca PoolBusca;
+
+typedef struct {
+    PoolBusca *pb;
+    int indice;
+} ArgBusca;
+
+struct PoolBusca {
+    TrabalhoRaiz trabalhos[BUSCA_MAX_THREADS];
+    ArgBusca args[BUSCA_MAX_THREADS];
+    pthread_t threads[BUSCA_MAX_THREADS];
+    int criada[BUSCA_MAX_THREADS];
+    int numThreads;
+    pthread_mutex_t trava;
+    pthread_cond_t inicio;    // nova rodada ou encerramento
+    pthread_cond_t fim;       // todas as threads auxiliares terminaram a rodada
+    unsigned rodada;
+    int pendentes;
+    int encerrar;
+};
+
+static void* threadBusca(void *arg) {
+    PoolBusca *pb = ((ArgBusca*) arg)->pb;
+    TrabalhoRaiz *t = &pb->trabalhos[((ArgBusca*) arg)->indice];
+    unsigned vista = 0;
+    pthread_mutex_lock(&pb->trava);
+    for (;;) {
+        while (pb->rodada == vista && !pb->encerrar) pthread_cond_wait(&pb->inicio, &pb->trava);
+        if (pb->encerrar) break;
+        vista = pb->rodada;
+        pthread_mutex_unlock(&pb->trava);
+        trabalhadorRaiz(t);
+        pthread_mutex_lock(&pb->trava);
+        if (--pb->pendentes == 0) pthread_cond_signal(&pb->fim);
+    }
+    pthread_mutex_unlock(&pb->trava);
+    return NULL;
+}
+
+/*
+ * iniciarPoolBusca() – prepara 'numThreads' (limitado a 1..5) buscadores para
+ * a partida 'j' e cria as threads auxiliares, que ficam esperando as dicas.
+ */
+void iniciarPoolBusca(PoolBusca *pb, Jogo *j, const Zobrist *z, TabelaTransposicao *tt, int numThreads) {
+    if (numThreads < 1) numThreads = 1;
+    if (numThreads > BUSCA_MAX_THREADS) numThreads = BUSCA_MAX_THREADS;
+    pb->numThreads = numThreads;
+    pb->rodada = 0;
+    pb->pendentes = 0;
+    pb->encerrar = 0;
+    pthread_mutex_init(&pb->trava, NULL);
+    pthread_cond_init(&pb->inicio, NULL);
+    pthread_cond_init(&pb->fim, NULL);
+    for (int t = 0; t < numThreads; t++) {
+        pb->trabalhos[t].b = criarBuscador(j, z, tt);
+        pb->trabalhos[t].primeira = t + 1;
+        pb->trabalhos[t].passo = numThreads;
+        pb->args[t].pb = pb;
+        pb->args[t].indice = t;
+        pb->criada[t] = t > 0 && pthread_create(&pb->threads[t], NULL, threadBusca, &pb->args[t]) == 0;
+    }
+}
+
+void liberarPoolBusca(PoolBusca *pb) {
+    pthread_mutex_lock(&pb->trava);
+    pb->encerrar = 1;
+    pthread_cond_broadcast(&pb->inicio);
+    pthread_mutex_unlock(&pb->trava);
+    for (int t = 0; t < pb->numThreads; t++) {
+        if (pb->criada[t]) pthread_join(pb->threads[t], NULL);
+        liberarBuscador(pb->trabalhos[t].b);
+    }
+    pthread_cond_destroy(&pb->inicio);
+    pthread_cond_destroy(&pb->fim);
+    pthread_mutex_destroy(&pb->trava);
+}
+
+/*
+ * sugerirJogada() – escolhe a melhor opcao (1 a 5) olhando 'profundidade'
+ * jogadas a frente, com as threads de 'pb' (criado para esta partida).
+ */
+Dica sugerirJogada(PoolBusca *pb, Jogo *j, int profundidade) {
+    if (profundidade < 1) profundidade = 1;
+    if (profundidade > PROF_MAX) profundidade = PROF_MAX;
+
+    int auxiliares = 0;
+    for (int t = 0; t < pb->numThreads; t++) {
+        TrabalhoRaiz *tr = &pb->trabalhos[t];
+        tr->jogo = j;
+        tr->prof = profundidade;
+        for (int a = 0; a < 6; a++) tr->valor[a] = -1;
+        tr->b->gerador = j->gerador;
+        tr->b->nos = tr->b->acertosTT = 0;
+        auxiliares += pb->criada[t];
+    }
+    if (auxiliares) {
+        pthread_mutex_lock(&pb->trava);
+        pb->pendentes = auxiliares;
+        pb->rodada++;
+        pthread_cond_broadcast(&pb->inicio);
+        pthread_mutex_unlock(&pb->trava);
+    }
+    for (int t = 0; t < pb->numThreads; t++)
+        if (!pb->criada[t]) trabalhadorRaiz(&pb->trabalhos[t]); // thread 0 e as que nao puderam ser criadas
+    if (auxiliares) {
+        pthread_mutex_lock(&pb->trava);
+        while (pb->pendentes > 0) pthread_cond_wait(&pb->fim, &pb->trava);
+        pthread_mutex_unlock(&pb->trava);
+    }
+
+    Dica d = {0, 0, 0, 0};
+    for (int t = 0; t < pb->numThreads; t++) {
+        for (int a = 1; a <= 5; a++) {
+            long v = pb->trabalhos[t].valor[a];
+            if (v >= 0 && (!d.acao || v > d.valor || (v == d.valor && a < d.acao))) {
+                d.acao = a;
+                d.valor = v;
+            }
+        }
+        d.nos += pb->trabalhos[t].b->nos;
+        d.acertosTT += pb->trabalhos[t].b->acertosTT;
+    }
+    return d;
+}
+
+/*
+ * Joga 'turnos' jogadas escolhidas por sugerirJogada e reporta a pontuacao,
+ * os nos visitados e a taxa de acerto da tabela de transposicao.
+ */
+int executarAutomatico(Jogo *j, long turnos, int profundidade, int numThreads) {
+    Zobrist z;
+    TabelaTransposicao tt;
+    inicializarZobrist(&z, &j->fila, &j->pilha);
+    inicializarTT(&tt, TT_BITS_PADRAO);
+    PoolBusca pb;
+    iniciarPoolBusca(&pb, j, &z, &tt, numThreads);
+
+    long nos = 0, acertos = 0, jogadas = 0;
+    int salvaSaida = saidaAtiva;
+    saidaAtiva = 0;
+    double inicio = agoraSegundos();
+    for (long t = 0; t < turnos; t++) {
+        Dica d = sugerirJogada(&pb, j, profundidade);
+        nos += d.nos;
+        acertos += d.acertosTT;
+        if (!d.acao) break;
+        executarAcao(j, d.acao);
+        jogadas++;
+        INSTR_VERIFICAR_SINAL();
+    }
+    double decorrido = agoraSegundos() - inicio;
+    saidaAtiva = salvaSaida;
+
+    printf("Jogo automatico: %ld jogadas, profundidade %d, %d threads\n", jogadas, profundidade, pb.numThreads);
+    printf("Pontuacao: %ld\n", j->pontos);
+    printf("Nos visitados: %ld (%.1f%% resolvidos pela tabela de transposicao)\n",
+           nos, nos ? 100.0 * (double) acertos / (double) nos : 0.0);
+    printf("Tempo: %.6f s (%.0f nos/s)\n", decorrido, decorrido > 0 ? nos / decorrido : 0.0);
+    exibirEstado(&j->fila, &j->pilha);
+
+    liberarPoolBusca(&pb);
+    liberarTT(&tt);
+    liberarZobrist(&z);
+    return 0;
+}
+
+// ---------------------- MODO TEMPO REAL ----------------------
+/*
+ * Modo em tempo real (Linux): o terminal fica em modo cru e nao bloqueante,
+ * e um laco epoll multiplexa o teclado com um timerfd periodico. A cada
+ * tick a peca da frente e jogada automaticamente (opcao 1); as teclas 1 a 5
+ * sao aplicadas assim que chegam e 'q' (ou '0') encerra.
+ * Sao medidos o atraso de cada tick em relacao ao horario ideal (jitter) e
+ * o tempo entre o despertar por uma tecla e o fim do quadro correspondente.
+ */
+
+// Vetor crescente de amostras de tempo (em segundos)
+typedef struct {
+    double *v;
+    size_t n, cap;
+} Amostras;
+
+static void adicionarAmostra(Amostras *a, double x) {
+    if (a->n == a->cap) {
+        a->cap = a->cap ? a->cap * 2 : 1024;
+        double *novo = (double*) realloc(a->v, a->cap * sizeof(double));
+        if (!novo) return;
+        a->v = novo;
+    }
+    a->v[a->n++] = x;
+}
+
+static int compararDouble(const void *a, const void *b) {
+    double x = *(const double*) a, y = *(const double*) b;
+    return (x > y) - (x < y);
+}
+
+// Imprime media, p50, p99 e maximo das amostras (em microssegundos)
+static void resumirAmostras(const char *nome, Amostras *a) {
+    if (a->n == 0) {
+        printf("%-28s (sem amostras)\n", nome);
+        return;
+    }
+    qsort(a->v, a->n, sizeof(double), compararDouble);
+    double soma = 0;
+    for (size_t i = 0; i < a->n; i++) soma += a->v[i];
+    printf("%-28s n=%zu media=%.1fus p50=%.1fus p99=%.1fus max=%.1fus\n", nome, a->n,
+           soma / (double) a->n * 1e6, a->v[a->n / 2] * 1e6,
+           a->v[((a->n - 1) * 99 + 99) / 100] * 1e6, a->v[a->n - 1] * 1e6);
+}
+
+#ifdef __linux__
+
+static struct termios terminalOriginal;
+static int terminalAlterado = 0;
+
+static void restaurarTerminal(void) {
+    if (terminalAlterado) {
+        tcsetattr(STDIN_FILENO, TCSANOW, &terminalOriginal);
+        terminalAlterado = 0;
+    }
+}
+
+// Coloca o terminal em modo cru (sem eco, sem buffer de linha)
+static int terminalCru(void) {
+    if (!isatty(STDIN_FILENO)) return 0;
+    if (tcgetattr(STDIN_FILENO, &terminalOriginal) != 0) return -1;
+    struct termios cru = terminalOriginal;
+    cru.c_lflag &= (tcflag_t) ~(ICANON | ECHO);
+    cru.c_cc[VMIN] = 0;
+    cru.c_cc[VTIME] = 0;
+    if (tcsetattr(STDIN_FILENO, TCSANOW, &cru) != 0) return -1;
+    terminalAlterado = 1;
+    atexit(restaurarTerminal);
+    return 0;
+}
+
+static void montarQuadroTempoReal(Renderizador *r, Jogo *j, long ticks, int tickMs) {
+    rendLimpar(r);
+    montarEstado(r, &j->fila, &j->pilha);
+    rendLinha(r, "Pontuacao: %ld   Ticks: %ld (%d ms)", j->pontos, ticks, tickMs);
+    rendLinha(r, "%s", ultimaMensagem);
+    rendLinha(r, "Teclas: 1 jogar, 2 reservar, 3 usar reserva, 4 troca, 5 troca multipla, q sair");
+}
+
+int executarTempoReal(Jogo *j, Renderizador *r, int tickMs) {
+    if (tickMs < 1) tickMs = 1;
+    if (terminalCru() != 0) {
+        fprintf(stderr, "Erro: nao foi possivel configurar o terminal\n");
+        return 1;
+    }
+    int flags = fcntl(STDIN_FILENO, F_GETFL, 0);
+    fcntl(STDIN_FILENO, F_SETFL, flags | O_NONBLOCK);
+
+    int tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+    int ep = epoll_create1(0);
+    if (tfd < 0 || ep < 0) {
+        fprintf(stderr, "Erro: epoll/timerfd indisponivel\n");
+        fcntl(STDIN_FILENO, F_SETFL, flags);
+        restaurarTerminal();
+        return 1;
+    }
+
+    struct itimerspec periodo;
+    periodo.it_interval.tv_sec = tickMs / 1000;
+    periodo.it_interval.tv_nsec = (long) (tickMs % 1000) * 1000000L;
+    periodo.it_value = periodo.it_interval;
+    double intervalo = tickMs / 1000.0;
+    double inicio = agoraSegundos();
+
+    // arquivo comum nao entra no epoll (EPERM): sempre pronto, e lido a cada tick
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.fd = STDIN_FILENO;
+    int entradaNoTick = 0;
+    int ok = epoll_ctl(ep, EPOLL_CTL_ADD, STDIN_FILENO, &ev) == 0;
+    if (!ok && errno == EPERM) ok = entradaNoTick = 1;
+    ev.data.fd = tfd;
+    if (!ok || epoll_ctl(ep, EPOLL_CTL_ADD, tfd, &ev) != 0 || timerfd_settime(tfd, 0, &periodo, NULL) != 0) {
+        fprintf(stderr, "Erro: nao foi possivel registrar entrada/timer no epoll\n");
+        close(tfd);
+        close(ep);
+        fcntl(STDIN_FILENO, F_SETFL, flags);
+        restaurarTerminal();
+        return 1;
+    }
+
+    Amostras jitter = {0}, latencia = {0};
+    long ticks = 0, ticksPerdidos = 0, teclas = 0;
+    int rodando = 1;
+
+    montarQuadroTempoReal(r, j, ticks, tickMs);
+    rendApresentar(r, 1);
+
+    while (rodando) {
+        struct epoll_event eventos[2];
+        int n = epoll_wait(ep, eventos, 2, -1);
+        double despertar = agoraSegundos();
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        for (int e = 0; e < n && rodando; e++) {
+            int lerEntrada = eventos[e].data.fd != tfd;
+            if (!lerEntrada) {
+                uint64_t expiracoes;
+                if (read(tfd, &expiracoes, sizeof(expiracoes)) != (ssize_t) sizeof(expiracoes))
+                    continue;
+                ticks += (long) expiracoes;
+                ticksPerdidos += (long) expiracoes - 1;
+                // atraso em relacao ao instante ideal do tick mais recente
+                adicionarAmostra(&jitter, despertar - (inicio + (double) ticks * intervalo));
+                executarAcao(j, 1);
+                montarQuadroTempoReal(r, j, ticks, tickMs);
+                rendApresentar(r, 0);
+                lerEntrada = entradaNoTick;
+            }
+            if (lerEntrada) {
+                char teclasLidas[64];
+                ssize_t lidos = read(STDIN_FILENO, teclasLidas, sizeof(teclasLidas));
+                if (lidos == 0 && !isatty(STDIN_FILENO)) rodando = 0; // fim da entrada
+                for (ssize_t i = 0; i < lidos && rodando; i++) {
+                    char c = teclasLidas[i];
+                    if (c == 'q' || c == 'Q' || c == '0') {
+                        rodando = 0;
+                    } else if (c >= '1' && c <= '5') {
+                        executarAcao(j, c - '0');
+                        teclas++;
+                    }
+                }
+                if (rodando && lidos > 0) {
+                    montarQuadroTempoReal(r, j, ticks, tickMs);
+                    rendApresentar(r, 1);
+                    adicionarAmostra(&latencia, agoraSegundos() - despertar);
+                }
+            }
+        }
+    }
+
+    close(tfd);
+    close(ep);
+    fcntl(STDIN_FILENO, F_SETFL, flags);
+    restaurarTerminal();
+
+    printf("\nTempo real: %.2f s, %ld ticks (%ld perdidos), %ld teclas, pontuacao %ld\n",
+           agoraSegundos() - inicio, ticks, ticksPerdidos, teclas, j->pontos);
+    resumirAmostras("Jitter do tick:", &jitter);
+    resumirAmostras("Latencia tecla -> quadro:", &latencia);
+    printf("Quadros: %ld apresentados, %ld descartados pelo limite\n", r->quadros, r->descartados);
+    free(jitter.v);
+    free(latencia.v);
+    return 0;
+}
+
+#else
+
+int executarTempoReal(Jogo *j, Renderizador *r, int tickMs) {
+    (void) j;
+    (void) r;
+    (void) tickMs;
+    fprintf(stderr, "Modo tempo real disponivel apenas no Linux (epoll/timerfd).\n");
+    return 1;
+}
+
+#endif
+
+// ---------------------- REPRODUCAO DE DIARIO ----------------------
+
+/*
+ * Reconstroi o estado apos 'turnoAlvo' acoes (ou ao fim do diario, se
+ * turnoAlvo < 0): carrega o instantaneo mais proximo anterior ao turno pela
+ * busca binaria no indice e reaplica apenas as acoes seguintes. As pecas
+ * repostas vem do proprio diario, nao do gerador.
+ */
+int executarReproducao(const char *caminho, long turnoAlvo) {
+    Diario d;
+    if (diarioAbrirLeitura(&d, caminho) != 0) {
+        fprintf(stderr, "Erro: '%s' nao e um diario valido\n", caminho);
+        return 1;
+    }
+    uint64_t alvo = turnoAlvo < 0 ? UINT64_MAX : (uint64_t) turnoAlvo;
+
+    double inicio = agoraSegundos();
+
+    // ultimo instantaneo com turno <= alvo
+    size_t lo = 0, hi = d.numIndice;
+    while (hi - lo > 1) {
+        size_t meio = lo + (hi - lo) / 2;
+        if (d.indice[meio].turno <= alvo) lo = meio;
+        else hi = meio;
+    }
+
+    Jogo jogo;
+    Gerador g;
+    inicializarGerador(&g, d.semente, (ModoGerador) d.modoGerador);
+    inicializarFila(&jogo.fila, d.capFila);
+    inicializarPilha(&jogo.pilha, d.capPilha);
+    jogo.gerador = g;
+    jogo.produtor = NULL;
+    jogo.diario = NULL;
+    jogo.reproducao = &d;
+    jogo.ultimoTipo = NUM_TIPOS;
+    jogo.pontos = 0;
+
+    d.pos = (size_t) d.indice[lo].deslocamento + 1;
+    diarioLerInstantaneo(&d, &jogo.fila, &jogo.pilha, &jogo.idCounter);
+    uint64_t turnoInstantaneo = d.turno;
+
+    long reaplicadas = 0;
+    int salvaSaida = saidaAtiva;
+    saidaAtiva = 0;
+    while (d.turno < alvo) {
+        int acao, k;
+        int tipo = diarioPularRegistro(&d, &acao, &k);
+        if (tipo < 0) break;
+        if (tipo != REG_ACAO) continue;
+        if (acao == 6)
+            trocarBloco(&jogo.fila, &jogo.pilha, k);
+        else
+            executarAcao(&jogo, acao);
+        d.turno++;
+        reaplicadas++;
+    }
+    saidaAtiva = salvaSaida;
+    double decorrido = agoraSegundos() - inicio;
+
+    printf("Diario: %s (%zu bytes, %zu instantaneos a cada %d turnos)\n",
+           caminho, d.tamanho, d.numIndice, d.intervalo);
+    printf("Turno %llu: a partir do instantaneo do turno %llu, %ld acoes reaplicadas em %.6f s\n",
+           (unsigned long long) d.turno, (unsigned long long) turnoInstantaneo,
+           reaplicadas, decorrido);
+    printf("Proximo id: %d\n", jogo.idCounter);
+    exibirEstado(&jogo.fila, &jogo.pilha);
+
+    liberarJogo(&jogo);
+    diarioFecharLeitura(&d);
+    return 0;
+}
+
+// ---------------------- MODO EM LOTE ----------------------
+
+/*
+ * Le um fluxo de comandos compacto (um digito por acao, '1' a '5'; espacos e
+ * quebras de linha sao ignorados; '0' encerra o fluxo) e o executa sem
+ * renderizacao. O fluxo inteiro e carregado em memoria antes da medicao, de
+ * modo que o tempo reportado corresponde apenas as operacoes de fila/pilha.
+ * 'repeticoes' permite reaplicar o mesmo fluxo varias vezes (teste de carga).
+ * Se 'rend' nao for NULL, o estado e redesenhado a cada acao, sujeito ao
+ * limite de quadros do renderizador.
+ */
+int executarLote(FILE *entrada, long repeticoes, int capacidadeFila, int capacidadePilha,
+                 const Gerador *g, Produtor *produtor, Renderizador *rend, Diario *diario) {
+    size_t cap = 1 << 16, tam = 0, lidos;
+    char *cmds = (char*) malloc(cap);
+    if (!cmds) {
+        fprintf(stderr, "Erro: falha na alocacao do fluxo de comandos\n");
+        return 1;
+    }
+
+    // Carrega o fluxo, mantendo apenas os digitos de acao
+    char bloco[1 << 16];
+    int fim = 0;
+    while (!fim && (lidos = fread(bloco, 1, sizeof(bloco), entrada)) > 0) {
+        for (size_t i = 0; i < lidos; i++) {
+            char c = bloco[i];
+            if (c == '0') { fim = 1; break; }
+            if (c < '1' || c > '5') continue;
+            if (tam == cap) {
+                cap *= 2;
+                char *novo = (char*) realloc(cmds, cap);
+                if (!novo) {
+                    fprintf(stderr, "Erro: falha na alocacao do fluxo de comandos\n");
+                    free(cmds);
+                    return 1;
+                }
+                cmds = novo;
+            }
+            cmds[tam++] = (char)(c - '0');
+        }
+    }
+
+    Jogo jogo;
+    inicializarJogo(&jogo, capacidadeFila, capacidadePilha, g, produtor);
+    anexarDiario(&jogo, diario);
+
+    long efetivas[6] = {0};
+    long total = 0;
+
+    saidaAtiva = 0;
+    double inicio = agoraSegundos();
+    for (long r = 0; r < repeticoes; r++) {
+        for (size_t i = 0; i < tam; i++) {
+            efetivas[(int)cmds[i]] += executarAcao(&jogo, cmds[i]);
+            INSTR_VERIFICAR_SINAL();
+            if (rend && rendQuadroDevido(rend)) {
+                rendLimpar(rend);
+                montarEstado(rend, &jogo.fila, &jogo.pilha);
+                rendApresentar(rend, 0);
+            }
+        }
+        total += (long)tam;
+    }
+    double decorrido = agoraSegundos() - inicio;
+    saidaAtiva = 1;
+
+    if (rend) {
+        printf("\nQuadros: %ld apresentados, %ld descartados pelo limite, %ld bytes\n",
+               rend->quadros, rend->descartados, rend->bytes);
+    }
+    printf("Modo em lote: %ld comandos (%zu por repeticao x %ld)\n", total, tam, repeticoes);
+    printf("Tempo: %.6f s\n", decorrido);
+    if (decorrido > 0)
+        printf("Vazao: %.0f ops/s\n", total / decorrido);
+    printf("Acoes efetivas: jogar=%ld reservar=%ld usar=%ld troca=%ld troca_multipla=%ld\n",
+           efetivas[1], efetivas[2], efetivas[3], efetivas[4], efetivas[5]);
+    printf("Semente: %llu (%s)\n", (unsigned long long) g->semente,
+           g->modo == GERADOR_SACO ? "saco" : "uniforme");
+    printf("Proximo id: %d\n", jogo.idCounter);
+    printf("Pontuacao: %ld\n", jogo.pontos);
+    printf("Estado final:");
+    exibirEstado(&jogo.fila, &jogo.pilha);
+
+    liberarJogo(&jogo);
+    free(cmds);
+    return 0;
+}
+
+// ---------------------- SIMULACAO MULTISSESSAO ----------------------
+/*
+ * Motor que mantem N partidas independentes em estrutura de vetores (SoA):
+ * tipos e ids das pecas ficam em vetores compactos separados, e frente,
+ * quantidade e topo de cada sessao em vetores proprios. Uma acao em lote
+ * (um comando por sessao) percorre esses vetores sequencialmente.
+ * As regras sao as mesmas de executarAcao, incluindo a reposicao da fila com
+ * gerarPeca apos jogar/reservar; cada sessao tem seu proprio Gerador
+ * (semente base + indice da sessao).
+ * As sessoes sao divididas em faixas contiguas entre as threads; como as
+ * sessoes nao compartilham estado, nao ha sincronizacao durante a simulacao.
+ */
+typedef struct {
+    int numSessoes;
+    int capFila;         // limite logico da fila (filaCheia)
+    int strideFila;      // capFila arredondada para potencia de dois
+    int capPilha;
+    char *filaTipo;      // numSessoes * strideFila
+    int *filaId;
+    int *filaFrente;
+    int *filaQtd;
+    char *pilhaTipo;     // numSessoes * capPilha
+    int *pilhaId;
+    int *pilhaTopo;
+    int *proximoId;
+    Gerador gerador;     // semente base e modo; a sessao s usa semente + s
+} Motor;
+
+// Gerador da sessao s
+static inline Gerador geradorSessao(const Motor *m, int s) {
+    Gerador g = m->gerador;
+    g.semente += (uint64_t) s;
+    return g;
+}
+
+static void* alocarOuSair(size_t bytes) {
+    void *p = malloc(bytes);
+    if (!p) {
+        fprintf(stderr, "Erro: falha na alocacao do motor de simulacao\n");
+        exit(1);
+    }
+    return p;
+}
+
+// Cria as sessoes, cada uma com a fila cheia e a pilha vazia
+void inicializarMotor(Motor *m, int numSessoes, int capFila, int capPilha, const Gerador *g) {
+    m->numSessoes = numSessoes;
+    m->capFila = capFila;
+    m->capPilha = capPilha;
+    m->strideFila = (int) proximaPotenciaDois((unsigned) capFila);
+    m->gerador = *g;
+
+    size_t n = (size_t) numSessoes;
+    m->filaTipo = (char*) alocarOuSair(n * (size_t) m->strideFila);
+    m->filaId = (int*) alocarOuSair(n * (size_t) m->strideFila * sizeof(int));
+    m->filaFrente = (int*) alocarOuSair(n * sizeof(int));
+    m->filaQtd = (int*) alocarOuSair(n * sizeof(int));
+    m->pilhaTipo = (char*) alocarOuSair(n * (size_t) capPilha);
+    m->pilhaId = (int*) alocarOuSair(n * (size_t) capPilha * sizeof(int));
+    m->pilhaTopo = (int*) alocarOuSair(n * sizeof(int));
+    m->proximoId = (int*) alocarOuSair(n * sizeof(int));
+
+    Peca *lote = (Peca*) alocarOuSair((size_t) capFila * sizeof(Peca));
+    for (int s = 0; s < numSessoes; s++) {
+        Gerador gs = geradorSessao(m, s);
+        gerarPecas(&gs, lote, capFila, 0);
+        size_t base = (size_t) s * (size_t) m->strideFila;
+        for (int i = 0; i < capFila; i++) {
+            m->filaTipo[base + (size_t) i] = lote[i].tipo;
+            m->filaId[base + (size_t) i] = lote[i].id;
+        }
+        m->filaFrente[s] = 0;
+        m->filaQtd[s] = capFila;
+        m->pilhaTopo[s] = -1;
+        m->proximoId[s] = capFila;
+    }
+    free(lote);
+}
+
+void liberarMotor(Motor *m) {
+    free(m->filaTipo);
+    free(m->filaId);
+    free(m->filaFrente);
+    free(m->filaQtd);
+    free(m->pilhaTipo);
+    free(m->pilhaId);
+    free(m->pilhaTopo);
+    free(m->proximoId);
+}
+
+/*
+ * Aplica um lote de acoes: acoes[s - inicio] e o comando (1 a 5) da sessao s,
+ * para s em [inicio, fim). Acumula em efetivas[acao] as acoes que tiveram efeito.
+ */
+void motorAplicarLote(Motor *m, const unsigned char *acoes, int inicio, int fim, long efetivas[6]) {
+    const int mascara = m->strideFila - 1;
+    for (int s = inicio; s < fim; s++) {
+        size_t baseFila = (size_t) s * (size_t) m->strideFila;
+        size_t basePilha = (size_t) s * (size_t) m->capPilha;
+        char *fTipo = m->filaTipo + baseFila;
+        int *fId = m->filaId + baseFila;
+        char *pTipo = m->pilhaTipo + basePilha;
+        int *pId = m->pilhaId + basePilha;
+        int frente = m->filaFrente[s];
+        int qtd = m->filaQtd[s];
+        int topo = m->pilhaTopo[s];
+        int acao = acoes[s - inicio];
+        int ok = 0;
+
+        switch (acao) {
+            case 1: // jogar: remove a frente e repoe
+            case 2: // reservar: move a frente para a pilha e repoe
+                if (qtd == 0) break;
+                if (acao == 2) {
+                    if (topo == m->capPilha - 1) break;
+                    topo++;
+                    pTipo[topo] = fTipo[frente];
+                    pId[topo] = fId[frente];
+                }
+                frente = (frente + 1) & mascara;
+                qtd--;
+                if (qtd < m->capFila) {
+                    Gerador gs = geradorSessao(m, s);
+                    Peca nova = gerarPeca(&gs, m->proximoId[s]++);
+                    int tras = (frente + qtd) & mascara;
+                    fTipo[tras] = nova.tipo;
+                    fId[tras] = nova.id;
+                    qtd++;
+                }
+                ok = 1;
+                break;
+            case 3: // usar reserva
+                if (topo >= 0) { topo--; ok = 1; }
+                break;
+            case 4: // troca simples
+            case 5: { // troca multipla
+                int k = acao == 4 ? 1 : 3;
+                if (qtd < k || topo < k - 1) break;
+                for (int i = 0; i < k; i++) {
+                    int idxFila = (frente + i) & mascara;
+                    int idxPilha = topo - i;
+                    char t = fTipo[idxFila]; fTipo[idxFila] = pTipo[idxPilha]; pTipo[idxPilha] = t;
+                    int id = fId[idxFila]; fId[idxFila] = pId[idxPilha]; pId[idxPilha] = id;
+                }
+                ok = 1;
+                break;
+            }
+            default:
+                break;
+        }
+
+        m->filaFrente[s] = frente;
+        m->filaQtd[s] = qtd;
+        m->pilhaTopo[s] = topo;
+        efetivas[acao < 6 ? acao : 0] += ok;
+    }
+}
+
+// Acao pseudoaleatoria (1 a 5) da sessao s no passo p, derivada da semente de acoes
+static inline unsigned char acaoSorteada(uint64_t sementeAcoes, int s, long p) {
+    uint64_t h = misturar64(sementeAcoes ^ ((uint64_t) s << 32) ^ (uint64_t) p);
+    return (unsigned char)(1 + (((h >> 32) * 5) >> 32));
+}
+
+// Faixa de sessoes processada por uma thread
+typedef struct {
+    Motor *motor;
+    int inicio, fim;
+    long passos;
+    uint64_t sementeAcoes;
+    long efetivas[6];
+} TrabalhoMotor;
+
+static void* trabalhadorMotor(void *arg) {
+    TrabalhoMotor *t = (TrabalhoMotor*) arg;
+    int n = t->fim - t->inicio;
+    unsigned char *acoes = (unsigned char*) alocarOuSair((size_t) (n > 0 ? n : 1));
+    for (long p = 0; p < t->passos; p++) {
+        for (int s = t->inicio; s < t->fim; s++)
+            acoes[s - t->inicio] = acaoSorteada(t->sementeAcoes, s, p);
+        motorAplicarLote(t->motor, acoes, t->inicio, t->fim, t->efetivas);
+    }
+    free(acoes);
+    INSTR_DESCARREGAR();
+    return NULL;
+}
+
+// Resumo do estado final de todas as sessoes (para comparar execucoes)
+uint64_t motorAssinatura(const Motor *m) {
+    uint64_t h = 0;
+    for (int s = 0; s < m->numSessoes; s++) {
+        uint64_t x = (uint64_t) m->proximoId[s];
+        for (int i = 0; i < m->filaQtd[s]; i++) {
+            size_t idx = (size_t) s * (size_t) m->strideFila +
+                         (size_t) ((m->filaFrente[s] + i) & (m->strideFila - 1));
+            x = misturar64(x ^ (uint64_t) m->filaTipo[idx] ^ ((uint64_t) m->filaId[idx] << 8));
+        }
+        for (int i = 0; i <= m->pilhaTopo[s]; i++) {
+            size_t idx = (size_t) s * (size_t) m->capPilha + (size_t) i;
+            x = misturar64(x ^ (uint64_t) m->pilhaTipo[idx] ^ ((uint64_t) m->pilhaId[idx] << 8));
+        }
+        h += misturar64(x ^ (uint64_t) s);
+    }
+    return h;
+}
+
+// Confere a sessao s do motor contra uma partida comum (executarAcao) com as mesmas acoes
+static int verificarSessao(const Motor *m, int s, long passos, uint64_t sementeAcoes) {
+    Jogo jogo;
+    Gerador gs = geradorSessao(m, s);
+    inicializarJogo(&jogo, m->capFila, m->capPilha, &gs, NULL);
+    int salvaSaida = saidaAtiva;
+    saidaAtiva = 0;
+    for (long p = 0; p < passos; p++)
+        executarAcao(&jogo, acaoSorteada(sementeAcoes, s, p));
+    saidaAtiva = salvaSaida;
+
+    int ok = jogo.idCounter == m->proximoId[s] &&
+             filaQuantidade(&jogo.fila) == m->filaQtd[s] &&
+             jogo.pilha.topo == m->pilhaTopo[s];
+    for (int i = 0; ok && i < m->filaQtd[s]; i++) {
+        size_t idx = (size_t) s * (size_t) m->strideFila +
+                     (size_t) ((m->filaFrente[s] + i) & (m->strideFila - 1));
+        Peca *pc = filaPosicao(&jogo.fila, i);
+        ok = pc->tipo == m->filaTipo[idx] && pc->id == m->filaId[idx];
+    }
+    for (int i = 0; ok && i <= m->pilhaTopo[s]; i++) {
+        size_t idx = (size_t) s * (size_t) m->capPilha + (size_t) i;
+        ok = jogo.pilha.pecas[i].tipo == m->pilhaTipo[idx] && jogo.pilha.pecas[i].id == m->pilhaId[idx];
+    }
+    liberarJogo(&jogo);
+    return ok;
+}
+
+// Numero de processadores disponiveis (1 se nao for possivel descobrir)
+int numeroProcessadores(void) {
+#ifdef _SC_NPROCESSORS_ONLN
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n > 0) return (int) n;
+#endif
+    return 1;
+}
+
+/*
+ * Executa 'passos' acoes pseudoaleatorias em cada uma das 'numSessoes' sessoes,
+ * dividindo as sessoes entre 'numThreads' threads, e reporta a vazao.
+ */
+int executarSimulacao(int numSessoes, long passos, int numThreads, int capFila, int capPilha,
+                      const Gerador *g) {
+    if (numSessoes < 1) numSessoes = 1;
+    if (numThreads < 1) numThreads = 1;
+    if (numThreads > numSessoes) numThreads = numSessoes;
+
+    Motor motor;
+    inicializarMotor(&motor, numSessoes, capFila, capPilha, g);
+    uint64_t sementeAcoes = misturar64(g->semente ^ 0xA5A5A5A5ULL);
+
+    TrabalhoMotor *trabalhos = (TrabalhoMotor*) alocarOuSair((size_t) numThreads * sizeof(TrabalhoMotor));
+    pthread_t *threads = (pthread_t*) alocarOuSair((size_t) numThreads * sizeof(pthread_t));
+
+    double inicio = agoraSegundos();
+    for (int t = 0; t < numThreads; t++) {
+        TrabalhoMotor *tr = &trabalhos[t];
+        tr->motor = &motor;
+        tr->inicio = (int) ((long) numSessoes * t / numThreads);
+        tr->fim = (int) ((long) numSessoes * (t + 1) / numThreads);
+        tr->passos = passos;
+        tr->sementeAcoes = sementeAcoes;
+        memset(tr->efetivas, 0, sizeof(tr->efetivas));
+        if (pthread_create(&threads[t], NULL, trabalhadorMotor, tr) != 0) {
+            trabalhadorMotor(tr); // sem thread: executa a faixa aqui mesmo
+            threads[t] = pthread_self();
+        }
+    }
+    for (int t = 0; t < numThreads; t++) {
+        if (!pthread_equal(threads[t], pthread_self()))
+            pthread_join(threads[t], NULL);
+    }
+    double decorrido = agoraSegundos() - inicio;
+
+    long efetivas[6] = {0};
+    for (int t = 0; t < numThreads; t++)
+        for (int a = 0; a < 6; a++) efetivas[a] += trabalhos[t].efetivas[a];
+    double total = (double) numSessoes * (double) passos;
+
+    printf("Simulacao: %d sessoes x %ld passos, %d threads\n", numSessoes, passos, numThreads);
+    printf("Tempo: %.6f s\n", decorrido);
+    if (decorrido > 0)
+        printf("Vazao: %.0f ops/s\n", total / decorrido);
+    printf("Acoes efetivas: jogar=%ld reservar=%ld usar=%ld troca=%ld troca_multipla=%ld\n",
+           efetivas[1], efetivas[2], efetivas[3], efetivas[4], efetivas[5]);
+    printf("Assinatura do estado final: %016llx\n", (unsigned long long) motorAssinatura(&motor));
+
+    int ok = verificarSessao(&motor, 0, passos, sementeAcoes) &&
+             verificarSessao(&motor, numSessoes - 1, passos, sementeAcoes);
+    printf("Verificacao contra executarAcao: %s\n", ok ? "ok" : "DIVERGENTE");
+
+    free(threads);
+    free(trabalhos);
+    liberarMotor(&motor);
+    return ok ? 0 : 1;
+}
+
+// ---------------------- MAIN ----------------------
+int main(int argc, char *argv[]) {
+    INSTR_INICIAR();
+
+    // Uso: tetris_Stack [--semente N] [--saco] [--fila N] [--pilha N] [--produtor] [--fps N]
+    //                   [--lote [arquivo|-] [--repetir N]]
+    //                   [--sessoes N [--passos P] [--threads T]]
+    //                   [--gravar arquivo [--intervalo N]] [--reproduzir arquivo [--turno N]]
+    //                   [--auto N] [--profundidade D] [--tempo-real [--tick ms]]
+    int modoLote = 0;
+    const char *arquivoLote = NULL;
+    long repeticoes = 1;
+    int capacidadeFila = TAM_FILA;
+    int capacidadePilha = TAM_PILHA;
+    int usarProdutor = 0;
+    uint64_t semente = (uint64_t) time(NULL);
+    ModoGerador modoGerador = GERADOR_UNIFORME;
+    double fpsMax = 0;
+    int numSessoes = 0;
+    const char *arquivoDiario = NULL;
+    const char *arquivoReproducao = NULL;
+    int intervaloInstantaneos = DIARIO_INTERVALO_PADRAO;
+    long turnoAlvo = -1;
+    long turnosAuto = 0;
+    int profundidade = 6;
+    int tempoReal = 0;
+    int tickMs = 500;
+    long passos = 1000;
+    int numThreads = numeroProcessadores();
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--lote") == 0) {
+            modoLote = 1;
+            if (i + 1 < argc && strncmp(argv[i + 1], "--", 2) != 0)
+                arquivoLote = argv[++i];
+        } else if (strcmp(argv[i], "--repetir") == 0 && i + 1 < argc) {
+            repeticoes = atol(argv[++i]);
+            if (repeticoes < 1) repeticoes = 1;
+        } else if (strcmp(argv[i], "--fila") == 0 && i + 1 < argc) {
+            capacidadeFila = atoi(argv[++i]);
+            if (capacidadeFila < 1) capacidadeFila = 1;
+        } else if (strcmp(argv[i], "--pilha") == 0 && i + 1 < argc) {
+            capacidadePilha = atoi(argv[++i]);
+            if (capacidadePilha < 1) capacidadePilha = 1;
+        } else if (strcmp(argv[i], "--produtor") == 0) {
+            usarProdutor = 1;
+        } else if (strcmp(argv[i], "--semente") == 0 && i + 1 < argc) {
+            semente = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--saco") == 0) {
+            modoGerador = GERADOR_SACO;
+        } else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc) {
+            fpsMax = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--sessoes") == 0 && i + 1 < argc) {
+            numSessoes = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--passos") == 0 && i + 1 < argc) {
+            passos = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            numThreads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--gravar") == 0 && i + 1 < argc) {
+            arquivoDiario = argv[++i];
+        } else if (strcmp(argv[i], "--intervalo") == 0 && i + 1 < argc) {
+            intervaloInstantaneos = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--reproduzir") == 0 && i + 1 < argc) {
+            arquivoReproducao = argv[++i];
+        } else if (strcmp(argv[i], "--turno") == 0 && i + 1 < argc) {
+            turnoAlvo = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--auto") == 0 && i + 1 < argc) {
+            turnosAuto = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--profundidade") == 0 && i + 1 < argc) {
+            profundidade = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--tempo-real") == 0) {
+            tempoReal = 1;
+        } else if (strcmp(argv[i], "--tick") == 0 && i + 1 < argc) {
+            tickMs = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "Uso: %s [--semente N] [--saco] [--fila N] [--pilha N] [--produtor] [--fps N] "
+                            "[--lote [arquivo|-] [--repetir N]] "
+                            "[--sessoes N [--passos P] [--threads T]] "
+                            "[--gravar arquivo [--intervalo N]] "
+                            "[--reproduzir arquivo [--turno N]] "
+                            "[--auto N] [--profundidade D] [--tempo-real [--tick ms]]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    Gerador gerador;
+    inicializarGerador(&gerador, semente, modoGerador);
+
+    if (arquivoReproducao)
+        return executarReproducao(arquivoReproducao, turnoAlvo);
+
+    if (numSessoes > 0)
+        return executarSimulacao(numSessoes, passos, numThreads, capacidadeFila,
+                                 capacidadePilha, &gerador);
+
+    Produtor produtor;
+    Produtor *pr = NULL;
+    if (usarProdutor) {
+        if (iniciarProdutor(&produtor, TAM_BUFFER_PRODUTOR, 0, &gerador) != 0) {
+            fprintf(stderr, "Erro: nao foi possivel iniciar a thread geradora\n");
+            return 1;
+        }
+        pr = &produtor;
+    }
+
+    Renderizador *rend = (Renderizador*) malloc(sizeof(Renderizador));
+    if (!rend) {
+        fprintf(stderr, "Erro: falha na alocacao do renderizador\n");
+        return 1;
+    }
+    rendIniciar(rend, fpsMax, isatty(STDOUT_FILENO));
+
+    Diario diario;
+    Diario *dr = NULL;
+    if (arquivoDiario) {
+        if (diarioAbrir(&diario, arquivoDiario, &gerador, capacidadeFila, capacidadePilha,
+                        intervaloInstantaneos) != 0) {
+            fprintf(stderr, "Erro: nao foi possivel criar o diario '%s'\n", arquivoDiario);
+            free(rend);
+            return 1;
+        }
+        dr = &diario;
+    }
+
+    if (modoLote) {
+        FILE *entrada = stdin;
+        if (arquivoLote && strcmp(arquivoLote, "-") != 0) {
+            entrada = fopen(arquivoLote, "r");
+            if (!entrada) {
+                fprintf(stderr, "Erro: nao foi possivel abrir '%s'\n", arquivoLote);
+                return 1;
+            }
+        }
+        // no modo em lote so ha desenho se um limite de quadros for pedido
+        int ret = executarLote(entrada, repeticoes, capacidadeFila, capacidadePilha, &gerador, pr,
+                               fpsMax > 0 ? rend : NULL, dr);
+        if (entrada != stdin) fclose(entrada);
+        if (pr) pararProdutor(pr);
+        if (dr) diarioFechar(dr);
+        free(rend);
+        return ret;
+    }
+
+    Jogo jogo;
+    inicializarJogo(&jogo, capacidadeFila, capacidadePilha, &gerador, pr);
+    anexarDiario(&jogo, dr);
+
+    if (turnosAuto > 0 || tempoReal) {
+        int ret = tempoReal ? executarTempoReal(&jogo, rend, tickMs)
+                            : executarAutomatico(&jogo, turnosAuto, profundidade, numThreads);
+        liberarJogo(&jogo);
+        if (pr) pararProdutor(pr);
+        if (dr) diarioFechar(dr);
+        free(rend);
+        return ret;
+    }
+
+    Zobrist zobrist;
+    TabelaTransposicao tt;
+    inicializarZobrist(&zobrist, &jogo.fila, &jogo.pilha);
+    inicializarTT(&tt, TT_BITS_PADRAO);
+    PoolBusca pb;
+    iniciarPoolBusca(&pb, &jogo, &zobrist, &tt, numThreads);
+
+    int opcao;
+    do {
+        rendLimpar(rend);
+        montarEstado(rend, &jogo.fila, &jogo.pilha);
+        rendLinha(rend, "Pontuacao: %ld", jogo.pontos);
+        rendLinha(rend, "%s", ultimaMensagem);
+        rendLinha(rend, "Opcoes disponiveis:");
+        rendLinha(rend, "1 - Jogar peca (remover da fila)");
+        rendLinha(rend, "2 - Reservar peca (mover para pilha)");
+        rendLinha(rend, "3 - Usar peca reservada (remover do topo da pilha)");
+        rendLinha(rend, "4 - Trocar peca da frente com o topo da pilha");
+        rendLinha(rend, "5 - Trocar as 3 primeiras da fila com as 3 da pilha");
+        rendLinha(rend, "6 - Trocar as k primeiras da fila com as k do topo da pilha");
+        rendLinha(rend, "7 - Pedir dica");
+        rendLinha(rend, "0 - Sair");
+        rendLinha(rend, "Opcao: ");
+        rendApresentar(rend, 1);
+        ultimaMensagem[0] = '\0';
+        INSTR_VERIFICAR_SINAL();
+        INSTR_INICIO(OP_ENTRADA);
+        int lidos = scanf("%d", &opcao);
+        INSTR_FIM(OP_ENTRADA);
+        if (lidos != 1) break;
+
+        if (opcao == 0) {
+            printf("Encerrando o programa...\n");
+        } else if (opcao == 6) {
+            int k;
+            printf("Quantidade de pecas (k): ");
+            if (scanf("%d", &k) != 1) break;
+            executarTrocaBloco(&jogo, k);
+        } else if (opcao == 7) {
+            Dica d = sugerirJogada(&pb, &jogo, profundidade);
+            if (d.acao)
+                mensagem("Dica: opcao %d (%ld pontos possiveis em %d jogadas; %ld estados, %ld na tabela)\n",
+                         d.acao, d.valor, profundidade, d.nos, d.acertosTT);
+            else
+                mensagem("Dica: nenhuma jogada possivel.\n");
+        } else {
+            executarAcao(&jogo, opcao);
+        }
+
+    } while (opcao != 0);
+
+    liberarPoolBusca(&pb);
+    liberarTT(&tt);
+    liberarZobrist(&zobrist);
+    liberarJogo(&jogo);
+    if (pr) pararProdutor(pr);
+    if (dr) diarioFechar(dr);
+    free(rend);
+    return 0;
+}